@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace sunshine {
+namespace details {
+
+/**
+ * @brief 基于排队时间 SLO 的准入控制（负载削减）
+ *
+ * 两个信号：
+ *  - 预测排队时间：队列深度 * 平均执行耗时(EWMA) / worker 数，提交时超过任务 SLO 即拒绝；
+ *  - CoDel 式常驻队列检测：出队时记录任务的排队时长(sojourn)，若在整个 interval 内
+ *    sojourn 一直高于 target，则判定为常驻队列（standing queue），此时已超出自身 SLO 的
+ *    可削减任务在出队时直接失败，不再占用 worker。sojourn 一旦低于 target 即解除。
+ *
+ * 所有状态都是原子量，多个 worker 并发更新时允许丢失个别样本（只影响估计精度）。
+ */
+class admissionController {
+public:
+    using clock = std::chrono::steady_clock;
+
+    void configure(std::chrono::microseconds target, std::chrono::microseconds interval) noexcept {
+        target_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(target).count(), std::memory_order_relaxed);
+        interval_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count(),
+                          std::memory_order_relaxed);
+    }
+
+    // worker 执行完一个任务后上报执行耗时
+    void on_service(std::chrono::nanoseconds d) noexcept {
+        int64_t old = svc_ewma_ns.load(std::memory_order_relaxed);
+        int64_t cur = d.count();
+        svc_ewma_ns.store(old == 0 ? cur : old + (cur - old) / 8, std::memory_order_relaxed);
+    }
+
+    // 出队时上报排队时长，维护 CoDel 状态
+    void on_sojourn(std::chrono::nanoseconds sojourn, clock::time_point now) noexcept {
+        int64_t now_ns = now.time_since_epoch().count();
+        if (sojourn.count() < target_ns.load(std::memory_order_relaxed)) {
+            first_above_ns.store(0, std::memory_order_relaxed);
+            standing.store(false, std::memory_order_relaxed);
+            return;
+        }
+        int64_t first = first_above_ns.load(std::memory_order_relaxed);
+        if (first == 0) {
+            first_above_ns.store(now_ns + interval_ns.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        } else if (now_ns >= first) {
+            standing.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    // 预测一个新任务从入队到开始执行的等待时间
+    std::chrono::nanoseconds predict(size_t depth, size_t workers) const noexcept {
+        if (workers == 0) workers = 1;
+        int64_t svc = svc_ewma_ns.load(std::memory_order_relaxed);
+        return std::chrono::nanoseconds(svc * static_cast<int64_t>(depth) / static_cast<int64_t>(workers));
+    }
+
+    bool standing_queue() const noexcept {
+        return standing.load(std::memory_order_relaxed);
+    }
+
+    std::chrono::nanoseconds service_ewma() const noexcept {
+        return std::chrono::nanoseconds(svc_ewma_ns.load(std::memory_order_relaxed));
+    }
+
+    void count_rejected() noexcept {
+        rejected.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint64_t num_rejected() const noexcept {
+        return rejected.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> target_ns = {5000000};     // CoDel target，默认 5ms
+    std::atomic<int64_t> interval_ns = {100000000}; // CoDel interval，默认 100ms
+    std::atomic<int64_t> svc_ewma_ns = {0};         // 执行耗时 EWMA（alpha = 1/8）
+    std::atomic<int64_t> first_above_ns = {0};      // sojourn 持续高于 target 的判定截止时刻
+    std::atomic<bool> standing = {false};           // 是否存在常驻队列
+    std::atomic<uint64_t> rejected = {0};           // 被拒绝/削减的任务数
+};
+
+} // namespace details
+} // namespace sunshine
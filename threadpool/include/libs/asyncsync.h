@@ -0,0 +1,342 @@
+#pragma once
+
+#include "libs/channel.h"
+#include "libs/workbranch.h"
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace sunshine {
+namespace details {
+
+/**
+ * 不阻塞 worker 的同步原语：等待者以续延（workbranch + 回调）排队，资源可用时才把回调提交到其分支。
+ * 与 channel 相同，唤醒在内部锁释放后统一投递；C++20 下也可以 co_await，协程在指定分支的 worker 上恢复。
+ */
+
+// 等待者队列中的一项
+struct syncWaiter {
+    workbranch *wb;
+    std::function<void()> cb;
+};
+
+#if defined(SUNSHINE_CHANNEL_COROUTINE)
+// 通用等待体：ready() 为真时不挂起，否则由 park(cb) 注册续延，续延在分支上恢复协程
+template <typename Ready, typename Park>
+struct syncAwaiter {
+    Ready ready;
+    Park park;
+
+    bool await_ready() {
+        return ready();
+    }
+    void await_suspend(std::coroutine_handle<> h) {
+        park([h] { h.resume(); });
+    }
+    void await_resume() {
+    }
+};
+
+template <typename Ready, typename Park>
+syncAwaiter<Ready, Park> make_sync_awaiter(Ready ready, Park park) {
+    return syncAwaiter<Ready, Park>{std::move(ready), std::move(park)};
+}
+#endif
+
+/**
+ * @brief 计数信号量：acquire 在没有许可时挂起为续延，release 按 FIFO 顺序把许可交给等待者
+ */
+class async_semaphore {
+public:
+    explicit async_semaphore(size_t initial) :
+        count(initial) {
+    }
+
+    async_semaphore(const async_semaphore &) = delete;
+    async_semaphore(async_semaphore &&) = delete;
+
+    /**
+     * @brief 获取一个许可；获得后 cb() 在 wb 上执行
+     */
+    template <typename F>
+    void acquire(workbranch &wb, F &&cb) {
+        postList posts;
+        {
+            std::lock_guard<std::mutex> lock(lok);
+            // 已有等待者时排在其后，避免插队导致饥饿
+            if (count > 0 && waiters.empty()) {
+                --count;
+                posts.emplace_back(&wb, std::forward<F>(cb));
+            } else {
+                waiters.push_back(syncWaiter{&wb, std::forward<F>(cb)});
+            }
+        }
+        deliver(posts);
+    }
+
+    // 非阻塞获取：没有许可时返回 false
+    bool try_acquire() {
+        std::lock_guard<std::mutex> lock(lok);
+        if (count == 0 || !waiters.empty()) return false;
+        --count;
+        return true;
+    }
+
+    // 归还 n 个许可，依次唤醒等待者
+    void release(size_t n = 1) {
+        postList posts;
+        {
+            std::lock_guard<std::mutex> lock(lok);
+            count += n;
+            while (count > 0 && !waiters.empty()) {
+                --count;
+                posts.emplace_back(waiters.front().wb, std::move(waiters.front().cb));
+                waiters.pop_front();
+            }
+        }
+        deliver(posts);
+    }
+
+    // 当前可用的许可数
+    size_t available() {
+        std::lock_guard<std::mutex> lock(lok);
+        return count;
+    }
+
+#if defined(SUNSHINE_CHANNEL_COROUTINE)
+    // co_await sem.async_acquire(wb)
+    auto async_acquire(workbranch &wb) {
+        return make_sync_awaiter([this] { return try_acquire(); },
+                                 [this, &wb](std::function<void()> cb) { acquire(wb, std::move(cb)); });
+    }
+#endif
+
+private:
+    std::mutex lok;
+    size_t count;
+    std::deque<syncWaiter> waiters;
+};
+
+/**
+ * @brief 互斥量：持有者在另一任务中 unlock 也可以，等待者不占用 worker
+ */
+class async_mutex {
+public:
+    async_mutex() :
+        sem(1) {
+    }
+
+    // 加锁；获得锁后 cb() 在 wb 上执行，调用方负责 unlock
+    template <typename F>
+    void lock(workbranch &wb, F &&cb) {
+        sem.acquire(wb, std::forward<F>(cb));
+    }
+
+    bool try_lock() {
+        return sem.try_acquire();
+    }
+
+    void unlock() {
+        sem.release();
+    }
+
+    /**
+     * @brief 在锁内执行 f()（在 wb 上），结束或抛出异常后自动解锁；异常会被重新抛出到 worker
+     */
+    template <typename F>
+    void with_lock(workbranch &wb, F &&f) {
+        lock(wb, [this, fn = std::decay_t<F>(std::forward<F>(f))]() mutable {
+            try {
+                fn();
+            } catch (...) {
+                unlock();
+                throw;
+            }
+            unlock();
+        });
+    }
+
+#if defined(SUNSHINE_CHANNEL_COROUTINE)
+    // co_await m.async_lock(wb); ...; m.unlock();
+    auto async_lock(workbranch &wb) {
+        return sem.async_acquire(wb);
+    }
+#endif
+
+private:
+    async_semaphore sem;
+};
+
+/**
+ * @brief 一次性门闩：计数减到 0 时放行所有等待者（及之后的等待者）
+ */
+class latch {
+public:
+    explicit latch(size_t expected) :
+        count(expected) {
+    }
+
+    latch(const latch &) = delete;
+    latch(latch &&) = delete;
+
+    void count_down(size_t n = 1) {
+        postList posts;
+        {
+            std::lock_guard<std::mutex> lock(lok);
+            if (n > count) throw std::logic_error("latch: count_down below zero");
+            count -= n;
+            if (count == 0) release_locked(posts);
+        }
+        deliver(posts);
+    }
+
+    bool try_wait() {
+        std::lock_guard<std::mutex> lock(lok);
+        return count == 0;
+    }
+
+    // 计数归零后 cb() 在 wb 上执行
+    template <typename F>
+    void wait(workbranch &wb, F &&cb) {
+        postList posts;
+        {
+            std::lock_guard<std::mutex> lock(lok);
+            if (count == 0) {
+                posts.emplace_back(&wb, std::forward<F>(cb));
+            } else {
+                waiters.push_back(syncWaiter{&wb, std::forward<F>(cb)});
+            }
+        }
+        deliver(posts);
+    }
+
+    template <typename F>
+    void arrive_and_wait(workbranch &wb, F &&cb, size_t n = 1) {
+        wait(wb, std::forward<F>(cb));
+        count_down(n);
+    }
+
+#if defined(SUNSHINE_CHANNEL_COROUTINE)
+    // co_await l.async_wait(wb)
+    auto async_wait(workbranch &wb) {
+        return make_sync_awaiter([this] { return try_wait(); },
+                                 [this, &wb](std::function<void()> cb) { wait(wb, std::move(cb)); });
+    }
+#endif
+
+private:
+    void release_locked(postList &posts) {
+        for (auto &w : waiters) posts.emplace_back(w.wb, std::move(w.cb));
+        waiters.clear();
+    }
+
+private:
+    std::mutex lok;
+    size_t count;
+    std::vector<syncWaiter> waiters;
+};
+
+/**
+ * @brief 可重复使用的屏障：每一阶段 expected 个参与者到达后执行 completion（在最后到达者的线程上），
+ *        然后放行本阶段的所有等待者并进入下一阶段
+ */
+class barrier {
+public:
+    explicit barrier(size_t expected, std::function<void()> completion = nullptr) :
+        expected(expected), completion(std::move(completion)) {
+        if (expected == 0) throw std::invalid_argument("barrier: expected must be at least 1");
+    }
+
+    barrier(const barrier &) = delete;
+    barrier(barrier &&) = delete;
+
+    // 到达并等待本阶段结束；之后 cb() 在 wb 上执行
+    template <typename F>
+    void arrive_and_wait(workbranch &wb, F &&cb) {
+        postList posts;
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock(lok);
+            waiters.push_back(syncWaiter{&wb, std::forward<F>(cb)});
+            last = arrive_locked(posts);
+        }
+        finish_phase(last, posts);
+    }
+
+    // 到达但不等待，并从之后的阶段中退出
+    void arrive_and_drop() {
+        postList posts;
+        bool last;
+        {
+            std::lock_guard<std::mutex> lock(lok);
+            --next_expected;
+            last = arrive_locked(posts);
+        }
+        finish_phase(last, posts);
+    }
+
+    // 已完成的阶段数
+    size_t phase() {
+        std::lock_guard<std::mutex> lock(lok);
+        return generation;
+    }
+
+#if defined(SUNSHINE_CHANNEL_COROUTINE)
+    // co_await b.async_arrive_and_wait(wb)
+    auto async_arrive_and_wait(workbranch &wb) {
+        return make_sync_awaiter([] { return false; },
+                                 [this, &wb](std::function<void()> cb) { arrive_and_wait(wb, std::move(cb)); });
+    }
+#endif
+
+private:
+    // 调用方持有 lok；本阶段最后一个到达者返回 true，并取走所有等待者
+    bool arrive_locked(postList &posts) {
+        if (++arrived < expected) return false;
+        for (auto &w : waiters) posts.emplace_back(w.wb, std::move(w.cb));
+        waiters.clear();
+        arrived = 0;
+        expected = next_expected;
+        ++generation;
+        return true;
+    }
+
+    // completion 在放行等待者之前执行；其异常不阻止放行
+    void finish_phase(bool last, postList &posts) {
+        if (!last) return;
+        std::exception_ptr err;
+        if (completion) {
+            try {
+                completion();
+            } catch (...) {
+                err = std::current_exception();
+            }
+        }
+        deliver(posts);
+        if (err) std::rethrow_exception(err);
+    }
+
+private:
+    std::mutex lok;
+    size_t expected;
+    size_t next_expected = expected;
+    size_t arrived = 0;
+    size_t generation = 0;
+    std::function<void()> completion;
+    std::vector<syncWaiter> waiters;
+};
+
+} // namespace details
+
+// 便捷别名
+using async_mutex = details::async_mutex;
+using async_semaphore = details::async_semaphore;
+using latch = details::latch;
+using barrier = details::barrier;
+
+} // namespace sunshine
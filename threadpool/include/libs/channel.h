@@ -0,0 +1,428 @@
+#pragma once
+
+#include "libs/workbranch.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define SUNSHINE_CHANNEL_COROUTINE 1
+#endif
+
+namespace sunshine {
+namespace details {
+
+// 一次 select（或一次普通的 send/recv）挂起后的唤醒令牌：多个通道上的等待者共享，只有一个能成功认领
+struct selectToken {
+    std::atomic<bool> fired = {false};
+};
+
+// 认领等待者；普通 send/recv 的等待者没有令牌，总能认领
+inline bool claim(const std::shared_ptr<selectToken> &token) {
+    return !token || !token->fired.exchange(true);
+}
+
+// 待投递的续延：在通道锁释放后提交到等待者所属的分支
+using postList = std::vector<std::pair<workbranch *, std::function<void()>>>;
+
+inline void deliver(postList &posts) {
+    for (auto &p : posts) p.first->submit(std::move(p.second));
+    posts.clear();
+}
+
+// 与元素类型无关的通道基类：select 需要按地址顺序锁住所有涉及的通道
+class channelBase {
+public:
+    std::mutex &mutex() {
+        return chLock;
+    }
+
+protected:
+    std::mutex chLock;
+};
+
+/**
+ * @brief MPMC 通道（CSP 风格），等待中的 send/recv 不占用 worker 线程
+ *
+ * 阻塞语义通过续延实现：recv/send 立即返回，结果就绪时把回调提交到调用方指定的 workbranch；
+ * 在 C++20 下还可以 co_await async_recv / async_send。selector 在多个通道操作中恰好完成一个。
+ * capacity 为 unbounded 时 send 永不等待；有界通道满时 send 挂起，直到有空位或被接收方直接取走。
+ * close 后 send 以 false 完成，recv 在取完剩余元素后得到 std::nullopt。
+ */
+template <typename T>
+class channel : public channelBase {
+public:
+    static constexpr size_t unbounded = static_cast<size_t>(-1);
+
+    struct recvWaiter {
+        std::shared_ptr<selectToken> token;
+        workbranch *wb;
+        std::function<void(std::optional<T>)> cb;
+    };
+
+    struct sendWaiter {
+        std::shared_ptr<selectToken> token;
+        workbranch *wb;
+        T value;
+        std::function<void(bool)> cb;
+    };
+
+    explicit channel(size_t capacity = unbounded) :
+        cap(capacity) {
+        if (cap == 0) throw std::invalid_argument("channel: capacity must be at least 1");
+    }
+
+    channel(const channel &) = delete;
+    channel(channel &&) = delete;
+
+    /**
+     * @brief 接收一个元素；cb(std::optional<T>) 在 wb 上执行，通道关闭且为空时参数为 std::nullopt
+     */
+    template <typename F>
+    void recv(workbranch &wb, F &&cb) {
+        postList posts;
+        {
+            std::lock_guard<std::mutex> lock(chLock);
+            std::optional<T> out;
+            if (recv_locked(out, posts)) {
+                posts.emplace_back(&wb, [cb = std::decay_t<F>(std::forward<F>(cb)), out = std::move(out)]() mutable {
+                    cb(std::move(out));
+                });
+            } else {
+                add_receiver(recvWaiter{nullptr, &wb, std::forward<F>(cb)});
+            }
+        }
+        deliver(posts);
+    }
+
+    /**
+     * @brief 发送一个元素；cb(bool) 在 wb 上执行：true 表示已放入通道或交给接收方，false 表示通道已关闭
+     */
+    template <typename F>
+    void send(workbranch &wb, T value, F &&cb) {
+        postList posts;
+        {
+            std::lock_guard<std::mutex> lock(chLock);
+            bool ok;
+            if (send_locked(value, ok, posts)) {
+                posts.emplace_back(&wb, [cb = std::decay_t<F>(std::forward<F>(cb)), ok]() mutable { cb(ok); });
+            } else {
+                add_sender(sendWaiter{nullptr, &wb, std::move(value), std::forward<F>(cb)});
+            }
+        }
+        deliver(posts);
+    }
+
+    // 非阻塞发送：通道已满或已关闭时返回 false
+    bool try_send(T value) {
+        postList posts;
+        bool ok = false;
+        {
+            std::lock_guard<std::mutex> lock(chLock);
+            if (!send_locked(value, ok, posts)) ok = false;
+        }
+        deliver(posts);
+        return ok;
+    }
+
+    // 非阻塞接收：没有可取元素时返回 std::nullopt
+    std::optional<T> try_recv() {
+        postList posts;
+        std::optional<T> out;
+        {
+            std::lock_guard<std::mutex> lock(chLock);
+            recv_locked(out, posts);
+        }
+        deliver(posts);
+        return out;
+    }
+
+    // 关闭通道：唤醒所有等待中的接收方（std::nullopt）与发送方（false）
+    void close() {
+        postList posts;
+        {
+            std::lock_guard<std::mutex> lock(chLock);
+            closed = true;
+            for (auto &w : receivers) {
+                if (claim(w.token)) posts.emplace_back(w.wb, [cb = std::move(w.cb)]() mutable { cb(std::nullopt); });
+            }
+            for (auto &w : senders) {
+                if (claim(w.token)) posts.emplace_back(w.wb, [cb = std::move(w.cb)]() mutable { cb(false); });
+            }
+            receivers.clear();
+            senders.clear();
+        }
+        deliver(posts);
+    }
+
+    size_t size() {
+        std::lock_guard<std::mutex> lock(chLock);
+        return buf.size();
+    }
+
+#if defined(SUNSHINE_CHANNEL_COROUTINE)
+    struct recvAwaiter {
+        channel &ch;
+        workbranch &wb;
+        std::optional<T> result;
+
+        bool await_ready() {
+            result = ch.try_recv();
+            return result.has_value();
+        }
+        void await_suspend(std::coroutine_handle<> h) {
+            ch.recv(wb, [this, h](std::optional<T> v) {
+                result = std::move(v);
+                h.resume();
+            });
+        }
+        std::optional<T> await_resume() {
+            return std::move(result);
+        }
+    };
+
+    struct sendAwaiter {
+        channel &ch;
+        workbranch &wb;
+        T value;
+        bool ok = false;
+
+        bool await_ready() {
+            return false;
+        }
+        void await_suspend(std::coroutine_handle<> h) {
+            ch.send(wb, std::move(value), [this, h](bool res) {
+                ok = res;
+                h.resume();
+            });
+        }
+        bool await_resume() {
+            return ok;
+        }
+    };
+
+    // co_await ch.async_recv(wb)：挂起时不占线程，恢复在 wb 的 worker 上
+    recvAwaiter async_recv(workbranch &wb) {
+        return recvAwaiter{*this, wb, std::nullopt};
+    }
+
+    // co_await ch.async_send(wb, v)：返回是否发送成功
+    sendAwaiter async_send(workbranch &wb, T value) {
+        return sendAwaiter{*this, wb, std::move(value)};
+    }
+#endif
+
+private:
+    friend class selector;
+
+    // 以下函数调用方持有 chLock
+
+    // 尝试立即接收；成功（含通道已关闭）返回 true
+    bool recv_locked(std::optional<T> &out, postList &posts) {
+        if (!buf.empty()) {
+            out = std::move(buf.front());
+            buf.pop_front();
+            // 腾出空位：接纳一个等待中的发送方
+            while (!senders.empty()) {
+                sendWaiter w = std::move(senders.front());
+                senders.pop_front();
+                if (!claim(w.token)) continue;
+                buf.push_back(std::move(w.value));
+                posts.emplace_back(w.wb, [cb = std::move(w.cb)]() mutable { cb(true); });
+                break;
+            }
+            return true;
+        }
+        while (!senders.empty()) {
+            sendWaiter w = std::move(senders.front());
+            senders.pop_front();
+            if (!claim(w.token)) continue;
+            out = std::move(w.value);
+            posts.emplace_back(w.wb, [cb = std::move(w.cb)]() mutable { cb(true); });
+            return true;
+        }
+        if (closed) {
+            out = std::nullopt;
+            return true;
+        }
+        return false;
+    }
+
+    // 尝试立即发送（直接交给等待中的接收方或放入缓冲区）；完成（含通道已关闭）返回 true
+    bool send_locked(T &value, bool &ok, postList &posts) {
+        if (closed) {
+            ok = false;
+            return true;
+        }
+        while (!receivers.empty()) {
+            recvWaiter w = std::move(receivers.front());
+            receivers.pop_front();
+            if (!claim(w.token)) continue;
+            posts.emplace_back(w.wb, [cb = std::move(w.cb), v = std::move(value)]() mutable { cb(std::move(v)); });
+            ok = true;
+            return true;
+        }
+        if (buf.size() < cap) {
+            buf.push_back(std::move(value));
+            ok = true;
+            return true;
+        }
+        return false;
+    }
+
+    // 登记等待者前顺带清理已被其他通道认领的 select 等待者
+    void add_receiver(recvWaiter &&w) {
+        while (!receivers.empty() && receivers.front().token && receivers.front().token->fired.load()) {
+            receivers.pop_front();
+        }
+        receivers.push_back(std::move(w));
+    }
+
+    void add_sender(sendWaiter &&w) {
+        while (!senders.empty() && senders.front().token && senders.front().token->fired.load()) {
+            senders.pop_front();
+        }
+        senders.push_back(std::move(w));
+    }
+
+private:
+    size_t cap;
+    bool closed = false;
+    std::deque<T> buf;
+    std::deque<recvWaiter> receivers;
+    std::deque<sendWaiter> senders;
+};
+
+/**
+ * @brief 在多个通道操作中恰好完成一个（Go 的 select）
+ *
+ * run() 按地址顺序锁住所有涉及的通道：有可立即完成的操作则完成其中一个（起点轮转，避免总偏向第一个）；
+ * 否则在每个通道上登记共享同一令牌的等待者后返回，之后第一个就绪的通道认领令牌，其余等待者作废。
+ * 被选中分支的回调提交到构造时给定的 workbranch 上执行。
+ *
+ * @code
+ * selector(wb)
+ *     .on_recv(a, [](std::optional<int> v) { ... })
+ *     .on_send(b, 42, [](bool ok) { ... })
+ *     .run();
+ * @endcode
+ */
+class selector {
+    struct selectCase {
+        virtual ~selectCase() = default;
+        virtual channelBase &chan() = 0;
+        virtual bool try_now(workbranch &wb, postList &posts) = 0;
+        virtual void wait(workbranch &wb, const std::shared_ptr<selectToken> &token) = 0;
+    };
+
+    template <typename T, typename F>
+    struct recvCase : selectCase {
+        channel<T> &ch;
+        F cb;
+
+        recvCase(channel<T> &c, F &&f) :
+            ch(c), cb(std::move(f)) {
+        }
+        channelBase &chan() override {
+            return ch;
+        }
+        bool try_now(workbranch &wb, postList &posts) override {
+            std::optional<T> out;
+            if (!ch.recv_locked(out, posts)) return false;
+            posts.emplace_back(&wb, [cb = std::move(cb), out = std::move(out)]() mutable { cb(std::move(out)); });
+            return true;
+        }
+        void wait(workbranch &wb, const std::shared_ptr<selectToken> &token) override {
+            ch.add_receiver(typename channel<T>::recvWaiter{token, &wb, std::move(cb)});
+        }
+    };
+
+    template <typename T, typename F>
+    struct sendCase : selectCase {
+        channel<T> &ch;
+        T value;
+        F cb;
+
+        sendCase(channel<T> &c, T v, F &&f) :
+            ch(c), value(std::move(v)), cb(std::move(f)) {
+        }
+        channelBase &chan() override {
+            return ch;
+        }
+        bool try_now(workbranch &wb, postList &posts) override {
+            bool ok;
+            if (!ch.send_locked(value, ok, posts)) return false;
+            posts.emplace_back(&wb, [cb = std::move(cb), ok]() mutable { cb(ok); });
+            return true;
+        }
+        void wait(workbranch &wb, const std::shared_ptr<selectToken> &token) override {
+            ch.add_sender(typename channel<T>::sendWaiter{token, &wb, std::move(value), std::move(cb)});
+        }
+    };
+
+public:
+    explicit selector(workbranch &wb) :
+        m_branch(wb) {
+    }
+
+    // 接收分支：f(std::optional<T>)
+    template <typename T, typename F>
+    selector &on_recv(channel<T> &ch, F &&f) {
+        cases.emplace_back(new recvCase<T, std::decay_t<F>>(ch, std::decay_t<F>(std::forward<F>(f))));
+        return *this;
+    }
+
+    // 发送分支：f(bool)
+    template <typename T, typename F>
+    selector &on_send(channel<T> &ch, T value, F &&f) {
+        cases.emplace_back(new sendCase<T, std::decay_t<F>>(ch, std::move(value), std::decay_t<F>(std::forward<F>(f))));
+        return *this;
+    }
+
+    // 执行 select（只能调用一次）
+    void run() {
+        if (cases.empty()) throw std::logic_error("selector: no cases");
+        std::vector<std::mutex *> locks;
+        for (auto &c : cases) locks.push_back(&c->chan().mutex());
+        std::sort(locks.begin(), locks.end());
+        locks.erase(std::unique(locks.begin(), locks.end()), locks.end());
+
+        postList posts;
+        for (auto *m : locks) m->lock();
+        static std::atomic<size_t> rotor = {0};
+        size_t start = rotor.fetch_add(1, std::memory_order_relaxed) % cases.size();
+        bool done = false;
+        for (size_t i = 0; i < cases.size() && !done; ++i) {
+            done = cases[(start + i) % cases.size()]->try_now(m_branch, posts);
+        }
+        if (!done) {
+            auto token = std::make_shared<selectToken>();
+            for (auto &c : cases) c->wait(m_branch, token);
+        }
+        for (auto it = locks.rbegin(); it != locks.rend(); ++it) (*it)->unlock();
+        deliver(posts);
+        cases.clear();
+    }
+
+private:
+    workbranch &m_branch;
+    std::vector<std::unique_ptr<selectCase>> cases;
+};
+
+} // namespace details
+
+// 便捷别名
+template <typename T>
+using channel = details::channel<T>;
+using selector = details::selector;
+
+} // namespace sunshine
@@ -0,0 +1,186 @@
+#pragma once
+
+#include "libs/timer.h"
+#include "libs/utility.h"
+#include "libs/workbranch.h"
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace sunshine {
+namespace details {
+
+/**
+ * @brief 小任务合批提交器：把大量极短任务攒成 chunk，以单个任务的形式进入 workbranch
+ *
+ * 用法：每个生产者线程持有一个自己的 coalescer（内部加锁只是为了与定时器线程的 flush 互斥，
+ * 正常情况下无竞争）。缓冲区在以下情况被 flush 成一个 chunk 任务：
+ *  - 缓冲任务数达到 chunk_size；
+ *  - 第一个任务进入缓冲区 linger 之后（需要提供 timer）；
+ *  - 显式调用 flush() 或 coalescer 析构。
+ * 未提供 timer 时没有按时间 flush，生产者须在空闲前自行调用 flush()。
+ *
+ * chunk 在 worker 上执行时，若分支中有空闲 worker 且剩余任务足够多，会把后一半切分出来
+ * 以 urgent 任务重新提交，让空闲 worker 立刻分担。
+ *
+ * 注意：workbranch / timer 的生命周期必须长于 coalescer。
+ */
+class coalescer {
+public:
+    using clock = std::chrono::steady_clock;
+
+private:
+    using chunkT = std::shared_ptr<std::vector<task>>;
+
+    // 缓冲区状态；定时器回调通过 weak_ptr 引用，避免 coalescer 析构后悬空
+    struct state {
+        workbranch *wb;
+        size_t chunk_size;
+        std::mutex lok;
+        std::vector<task> buf;
+        uint64_t gen = 0; // 每次 flush 递增，过期的定时 flush 据此失效
+
+        // 取出当前缓冲区并作为一个 chunk 提交
+        void flush() {
+            std::vector<task> items;
+            {
+                std::lock_guard<std::mutex> lock(lok);
+                if (buf.empty()) return;
+                items.swap(buf);
+                buf.reserve(chunk_size);
+                ++gen;
+            }
+            dispatch(wb, std::make_shared<std::vector<task>>(std::move(items)));
+        }
+
+        // 定时 flush：只有当缓冲区仍是定时器登记时那一批才 flush
+        void flush_if(uint64_t g) {
+            std::vector<task> items;
+            {
+                std::lock_guard<std::mutex> lock(lok);
+                if (gen != g || buf.empty()) return;
+                items.swap(buf);
+                buf.reserve(chunk_size);
+                ++gen;
+            }
+            dispatch(wb, std::make_shared<std::vector<task>>(std::move(items)));
+        }
+    };
+
+public:
+    /**
+     * @param wb 目标分支
+     * @param chunk_size 每个 chunk 的任务数上限（达到即 flush）
+     * @param linger 第一个任务进入缓冲区后最多等待多久被 flush（需提供 tm）
+     * @param tm 用于按时 flush 的定时器，可为 nullptr
+     */
+    explicit coalescer(workbranch &wb, size_t chunk_size = 64,
+                       std::chrono::microseconds linger = std::chrono::microseconds(100), timer *tm = nullptr) :
+        m_state(std::make_shared<state>()),
+        m_linger(linger), m_timer(tm) {
+        m_state->wb = &wb;
+        m_state->chunk_size = std::max<size_t>(chunk_size, 1);
+        m_state->buf.reserve(m_state->chunk_size);
+    }
+
+    coalescer(const coalescer &) = delete;
+    coalescer(coalescer &&) = delete;
+
+    // 析构时 flush 剩余任务；分支已 shutdown 时 submit 会抛出，此时缓冲中的任务被丢弃（异常不能逃出析构函数）
+    ~coalescer() {
+        try {
+            flush();
+        } catch (...) {
+        }
+    }
+
+public:
+    /**
+     * @brief 缓冲一个 void 任务
+     */
+    template <typename F>
+    void submit(F &&f) {
+        bool full = false;
+        bool first = false;
+        uint64_t gen = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_state->lok);
+            first = m_state->buf.empty();
+            m_state->buf.emplace_back(std::forward<F>(f));
+            full = m_state->buf.size() >= m_state->chunk_size;
+            gen = m_state->gen;
+        }
+        if (full) {
+            m_state->flush();
+        } else if (first && m_timer) {
+            std::weak_ptr<state> w = m_state;
+            m_timer->add(m_linger, [w, gen] {
+                if (auto s = w.lock()) s->flush_if(gen);
+            });
+        }
+    }
+
+    /**
+     * @brief 立即把缓冲区中的任务作为一个 chunk 提交
+     */
+    void flush() {
+        m_state->flush();
+    }
+
+    /**
+     * @brief 当前缓冲中的任务数
+     */
+    size_t buffered() {
+        std::lock_guard<std::mutex> lock(m_state->lok);
+        return m_state->buf.size();
+    }
+
+private:
+    static constexpr size_t split_min = 4; // 剩余任务不少于 2 * split_min 才考虑切分
+
+    static void dispatch(workbranch *wb, chunkT items) {
+        size_t n = items->size();
+        wb->submit<normal>([wb, items, n] { run_chunk(wb, items, 0, n); });
+    }
+
+    // 执行 [b, e) 范围内的任务；有空闲 worker 时把后一半切给它们
+    static void run_chunk(workbranch *wb, const chunkT &items, size_t b, size_t e) {
+        while (b < e) {
+            if (e - b >= 2 * split_min && wb->num_idle() > 0) {
+                size_t mid = b + (e - b) / 2;
+                // urgent 插到队首（且不会落入当前 worker 的 next 槽），空闲 worker 能立刻取到
+                wb->submit<urgent>([wb, items, mid, e] { run_chunk(wb, items, mid, e); });
+                e = mid;
+            }
+            try {
+                (*items)[b]();
+            } catch (const std::exception &ex) {
+                std::cerr << "workbranch: worker[" << std::this_thread::get_id()
+                          << "] caught exception:\n  what(): " << ex.what() << '\n'
+                          << std::flush;
+            } catch (...) {
+                std::cerr << "workbranch: worker[" << std::this_thread::get_id()
+                          << "] caught unknown exception\n"
+                          << std::flush;
+            }
+            ++b;
+        }
+    }
+
+private:
+    std::shared_ptr<state> m_state;
+    std::chrono::microseconds m_linger;
+    timer *m_timer = nullptr;
+};
+
+} // namespace details
+
+// 便捷别名
+using coalescer = details::coalescer;
+
+} // namespace sunshine
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "libs/hashring.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace sunshine {
+namespace details {
+
+/**
+ * @brief submit_costed 的成本提示：显式的预估耗时，或一个 tag（由该 tag 的历史执行耗时学习得到）
+ */
+struct costHint {
+    uint64_t ns = 0;           // 显式预估耗时（纳秒），0 表示未指定
+    const char *tag = nullptr; // 非空时按 tag 学习成本，任务同时被打上该 tag（与 tagged() 相同）
+
+    template <typename Rep, typename Period>
+    costHint(std::chrono::duration<Rep, Period> d) :
+        ns(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count())) {
+    }
+
+    costHint(const char *tag) :
+        tag(tag) {
+    }
+};
+
+/**
+ * @brief 按 tag 学习的任务执行耗时表（无锁）
+ *
+ * 固定 slots 个槽的开放寻址表，以 tag 指针为 key（tag 通常是字符串字面量，同一 tag 地址相同）；
+ * 每个槽保存执行耗时的 EWMA（系数 1/4）。表满后新的 tag 不再记录，估计值退回调用方的默认值。
+ */
+class costTable {
+public:
+    static constexpr size_t slots = 64;
+
+    // 返回 tag 的预估耗时（纳秒），尚无样本时返回 0
+    uint64_t estimate(const char *tag) const {
+        size_t i = index(tag);
+        for (size_t n = 0; n < slots; ++n, i = (i + 1) % slots) {
+            const char *k = table[i].key.load(std::memory_order_acquire);
+            if (k == tag) return table[i].ewma_ns.load(std::memory_order_relaxed);
+            if (!k) return 0;
+        }
+        return 0;
+    }
+
+    // 记录一次执行耗时；并发更新同一 tag 时可能丢失个别样本
+    void learn(const char *tag, std::chrono::nanoseconds elapsed) {
+        uint64_t ns = static_cast<uint64_t>(elapsed.count());
+        size_t i = index(tag);
+        for (size_t n = 0; n < slots; ++n, i = (i + 1) % slots) {
+            const char *k = table[i].key.load(std::memory_order_acquire);
+            if (!k && table[i].key.compare_exchange_strong(k, tag, std::memory_order_acq_rel)) k = tag;
+            if (k != tag) continue;
+            uint64_t old = table[i].ewma_ns.load(std::memory_order_relaxed);
+            table[i].ewma_ns.store(old ? old - (old >> 2) + (ns >> 2) : (ns ? ns : 1), std::memory_order_relaxed);
+            return;
+        }
+    }
+
+private:
+    static size_t index(const char *tag) {
+        return static_cast<size_t>(mix64(reinterpret_cast<uintptr_t>(tag)) % slots);
+    }
+
+    struct slot {
+        std::atomic<const char *> key = {nullptr};
+        std::atomic<uint64_t> ewma_ns = {0};
+    };
+
+    slot table[slots];
+};
+
+} // namespace details
+} // namespace sunshine
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sunshine {
+namespace details {
+
+// 某个 tag / 租户的 CPU 使用累计
+struct cpuUsage {
+    uint64_t tasks = 0;                 // 计入的任务数
+    std::chrono::nanoseconds cpu = {};  // 累计线程 CPU 时间
+};
+
+/**
+ * @brief 任务级 CPU 时间记账与租户 CPU 配额
+ *
+ * worker 在任务前后读取本线程 CPU 时钟（CLOCK_THREAD_CPUTIME_ID），差值按任务 tag 与租户汇总。
+ * 租户配额以「核数」表示：在滑动窗口 window 内 CPU 时间超过 cores * window 即视为超额。
+ * 窗口切成 slots 个时间片循环复用，过期时间片在访问时清零。
+ *
+ * 热路径不争用同一把锁：累计值按记录线程分片（每个 worker 固定落在一个分片上，分片锁基本无竞争），
+ * 读取时合并各分片。tag 按指针记账（与 costTable 相同，不为每个任务构造字符串），读取时按内容匹配，
+ * 因此内容相同但地址不同的 tag 会被合并；tag 须在记账对象的整个生命周期内有效（通常为字面量）。配额窗口的时间片是原子量，over_quota 无锁。并发更新时可能丢失个别样本（只影响精度）。
+ */
+class cpuAccount {
+public:
+    using tenant_t = uint32_t;
+    using clock = std::chrono::steady_clock;
+
+    // 当前线程已消耗的 CPU 时间；平台不支持时返回 0（记账结果全为 0）
+    static std::chrono::nanoseconds thread_now() noexcept {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+        timespec ts;
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+            return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+        }
+#endif
+        return std::chrono::nanoseconds(0);
+    }
+
+    cpuAccount() = default;
+    cpuAccount(const cpuAccount &) = delete;
+    cpuAccount(cpuAccount &&) = delete;
+
+    /**
+     * @brief 记一笔任务 CPU 时间
+     * @param tag 任务 tag，可为 nullptr（不计入 tag 统计）
+     * @param tenant 非空时计入该租户及其配额窗口
+     */
+    void record(const char *tag, const tenant_t *tenant, std::chrono::nanoseconds cpu, clock::time_point now) {
+        shard &sd = m_shards[shard_index()];
+        {
+            std::lock_guard<std::mutex> lock(sd.lok);
+            if (tag) {
+                cpuUsage &u = sd.by_tag[tag];
+                ++u.tasks;
+                u.cpu += cpu;
+            }
+            if (tenant) {
+                cpuUsage &u = sd.by_tenant[*tenant];
+                ++u.tasks;
+                u.cpu += cpu;
+            }
+        }
+        if (tenant && any_quota()) {
+            if (quotaWindow *q = find_quota(*tenant)) q->add(cpu.count(), now);
+        }
+    }
+
+    cpuUsage tag_usage(const std::string &tag) {
+        cpuUsage total;
+        for (auto &sd : m_shards) {
+            std::lock_guard<std::mutex> lock(sd.lok);
+            for (auto &each : sd.by_tag) {
+                if (std::strcmp(each.first, tag.c_str()) != 0) continue;
+                total.tasks += each.second.tasks;
+                total.cpu += each.second.cpu;
+            }
+        }
+        return total;
+    }
+
+    cpuUsage tenant_usage(tenant_t tenant) {
+        cpuUsage total;
+        for (auto &sd : m_shards) {
+            std::lock_guard<std::mutex> lock(sd.lok);
+            auto it = sd.by_tenant.find(tenant);
+            if (it == sd.by_tenant.end()) continue;
+            total.tasks += it->second.tasks;
+            total.cpu += it->second.cpu;
+        }
+        return total;
+    }
+
+    /**
+     * @brief 设置租户 CPU 配额；cores <= 0 表示取消配额
+     *
+     * 首次为某租户设置配额时以写时复制的方式发布新的配额表；旧表保留到析构，无锁读取方不会读到已释放的表。
+     */
+    void set_quota(tenant_t tenant, double cores, std::chrono::milliseconds window) {
+        std::lock_guard<std::mutex> lock(m_cfgLock);
+        quotaWindow *q = find_quota(tenant);
+        if (!q) {
+            m_windows.emplace_back(new quotaWindow());
+            q = m_windows.back().get();
+            const quotaMap *cur = m_quotas.load(std::memory_order_relaxed);
+            std::unique_ptr<quotaMap> next(cur ? new quotaMap(*cur) : new quotaMap());
+            next->emplace(tenant, q);
+            m_quotas.store(next.get(), std::memory_order_release);
+            m_maps.push_back(std::move(next));
+        }
+        q->slot_ns.store(std::max<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(window).count() / slots, 1),
+                         std::memory_order_relaxed);
+        for (size_t i = 0; i < slots; ++i) {
+            q->slot_epoch[i].store(-1, std::memory_order_relaxed);
+            q->slot_cpu[i].store(0, std::memory_order_relaxed);
+        }
+        q->cores.store(cores, std::memory_order_relaxed);
+        bool any = false;
+        for (auto &w : m_windows) any = any || w->cores.load(std::memory_order_relaxed) > 0;
+        has_quota.store(any, std::memory_order_relaxed);
+    }
+
+    // 是否有任何租户配置了配额（无锁，用于跳过热路径上的配额检查）
+    bool any_quota() const noexcept {
+        return has_quota.load(std::memory_order_relaxed);
+    }
+
+    // 租户在当前滑动窗口内是否超出配额（无锁）
+    bool over_quota(tenant_t tenant, clock::time_point now) const {
+        const quotaWindow *q = find_quota(tenant);
+        if (!q) return false;
+        double cores = q->cores.load(std::memory_order_relaxed);
+        if (cores <= 0) return false;
+        int64_t slot_ns = q->slot_ns.load(std::memory_order_relaxed);
+        int64_t cur = epoch_of(slot_ns, now);
+        int64_t used = 0;
+        for (size_t i = 0; i < slots; ++i) {
+            if (q->slot_epoch[i].load(std::memory_order_relaxed) > cur - static_cast<int64_t>(slots)) {
+                used += q->slot_cpu[i].load(std::memory_order_relaxed);
+            }
+        }
+        double budget = cores * static_cast<double>(slot_ns) * slots;
+        return static_cast<double>(used) > budget;
+    }
+
+private:
+    static constexpr size_t slots = 10;
+    static constexpr size_t shard_count = 16;
+
+    // 一个租户的配额滑动窗口：slots 个时间片，按 epoch 循环复用
+    struct quotaWindow {
+        std::atomic<double> cores = {0};
+        std::atomic<int64_t> slot_ns = {100000000};
+        std::array<std::atomic<int64_t>, slots> slot_cpu = {};
+        std::array<std::atomic<int64_t>, slots> slot_epoch = {};
+
+        // 计入当前时间片（过期则清零复用）；比时间片更旧的样本直接丢弃
+        void add(int64_t ns, clock::time_point now) noexcept {
+            int64_t e = epoch_of(slot_ns.load(std::memory_order_relaxed), now);
+            size_t i = static_cast<size_t>(e % static_cast<int64_t>(slots));
+            int64_t seen = slot_epoch[i].load(std::memory_order_relaxed);
+            if (seen > e) return;
+            if (seen < e && slot_epoch[i].compare_exchange_strong(seen, e, std::memory_order_relaxed)) {
+                slot_cpu[i].store(0, std::memory_order_relaxed);
+            }
+            slot_cpu[i].fetch_add(ns, std::memory_order_relaxed);
+        }
+    };
+
+    using quotaMap = std::unordered_map<tenant_t, quotaWindow *>;
+
+    // 累计值分片
+    struct alignas(64) shard {
+        std::mutex lok;
+        std::unordered_map<const char *, cpuUsage> by_tag; // 以 tag 指针为 key
+        std::unordered_map<tenant_t, cpuUsage> by_tenant;
+    };
+
+    static int64_t epoch_of(int64_t slot_ns, clock::time_point now) noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count() / slot_ns;
+    }
+
+    // 当前线程的分片编号：线程首次记账时轮流分配，之后固定不变
+    static size_t shard_index() noexcept {
+        static std::atomic<size_t> next = {0};
+        static thread_local size_t idx = next.fetch_add(1, std::memory_order_relaxed) % shard_count;
+        return idx;
+    }
+
+    quotaWindow *find_quota(tenant_t tenant) const noexcept {
+        const quotaMap *map = m_quotas.load(std::memory_order_acquire);
+        if (!map) return nullptr;
+        auto it = map->find(tenant);
+        return it == map->end() ? nullptr : it->second;
+    }
+
+private:
+    std::array<shard, shard_count> m_shards;
+    std::mutex m_cfgLock;                               // 串行化 set_quota
+    std::vector<std::unique_ptr<quotaWindow>> m_windows; // 各租户的配额窗口
+    std::vector<std::unique_ptr<quotaMap>> m_maps;       // 配额表的各个版本（最后一个为当前版本）
+    std::atomic<const quotaMap *> m_quotas = {nullptr};  // 当前配额表，无锁读取
+    std::atomic<bool> has_quota = {false};
+};
+
+} // namespace details
+} // namespace sunshine
@@ -0,0 +1,447 @@
+#pragma once
+
+// 持久化任务队列：mmap 的追加写日志（WAL）（POSIX）
+#if defined(__unix__) || defined(__APPLE__)
+
+#include "libs/autothread.h"
+#include "libs/remote.h"
+#include "libs/workbranch.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <dirent.h>
+#include <fcntl.h>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+namespace sunshine {
+namespace details {
+
+/**
+ * @brief 持久化分支：已注册类型的任务先写入日志并落盘，再交给 workbranch 执行
+ *
+ * 日志由固定大小的段文件（wal-<n>.seg）组成，每段 mmap 后顺序追加记录：
+ *  - task 记录：任务 id、类型与编码后的参数，submit 在其落盘后才返回；
+ *  - done 记录：任务执行结束后追加，不等待落盘（崩溃后最多重复执行一次，即 at-least-once）。
+ * 后台刷盘线程做组提交：一次 msync 覆盖期间所有提交者写入的记录，并发提交者共享同一次刷盘。
+ * 启动时按段顺序重放，未见 done 记录的任务重新提交。
+ * 压缩：最旧的非当前段中存活任务为 0 时直接删除；存活比例低于 1/4 时把存活任务搬到当前段后删除。
+ */
+class durablebranch {
+public:
+    /**
+     * @param dir 日志目录（需已存在）
+     * @param segment_bytes 单个段文件大小，单条记录不能超过它
+     */
+    durablebranch(const std::string &dir, workbranch &wb, taskRegistry &reg, size_t segment_bytes = size_t(64) << 20) :
+        m_dir(dir), m_branch(wb), m_registry(reg), m_segBytes(segment_bytes) {
+        // 重放失败（例如分支已关闭）时构造函数抛出，析构函数不会执行：
+        // 先等已提交的重放任务结束、停止刷盘线程并解除映射，再把异常抛给调用方
+        try {
+            std::vector<uint64_t> replayed = recover();
+            std::vector<pendingTask> tasks;
+            {
+                std::lock_guard<std::mutex> lock(m_lok);
+                roll();
+                for (uint64_t id : replayed) tasks.push_back(m_pending[id]);
+                m_running = replayed.size();
+            }
+            m_flusher.reset(new autoThread<join>(std::thread(&durablebranch::flush_loop, this)));
+            for (size_t i = 0; i < replayed.size(); ++i) {
+                try {
+                    dispatch(replayed[i], tasks[i].type, tasks[i].args);
+                } catch (...) {
+                    // dispatch 已撤销第 i 个任务的计数，其后尚未提交的任务一并撤销
+                    std::lock_guard<std::mutex> lock(m_lok);
+                    m_running -= replayed.size() - i - 1;
+                    if (m_running == 0) m_idle.notify_all();
+                    throw;
+                }
+            }
+        } catch (...) {
+            close();
+            throw;
+        }
+    }
+
+    durablebranch(const durablebranch &) = delete;
+    durablebranch(durablebranch &&) = delete;
+
+    /**
+     * @brief 析构：等待已提交到分支的任务执行完（以便写入 done 记录），刷盘后关闭日志
+     */
+    ~durablebranch() {
+        close();
+    }
+
+    /**
+     * @brief 持久化地提交一个任务
+     * @note 返回时 task 记录已落盘；任务随后在分支上执行（崩溃后重启时会重放）
+     */
+    template <typename Args>
+    void submit(uint32_t type, const Args &args) {
+        std::string payload;
+        codec<Args>::encode(args, payload);
+        std::unique_lock<std::mutex> lock(m_lok);
+        uint64_t id = m_nextId++;
+        uint64_t lsn = append(recordTask, id, type, payload);
+        pendingTask &p = m_pending[id];
+        p.segment = m_segments.back()->index;
+        p.type = type;
+        p.args = std::move(payload);
+        ++m_segments.back()->live;
+        m_work.notify_one();
+        // 组提交：等待刷盘线程把包含本记录的区间落盘
+        m_durable_cv.wait(lock, [this, lsn] { return m_durable >= lsn; });
+        ++m_running;
+        std::string copy = m_pending[id].args;
+        lock.unlock();
+        dispatch(id, type, copy);
+    }
+
+    // 尚未执行完成的任务数（含排队与执行中）
+    size_t num_pending() {
+        std::lock_guard<std::mutex> lock(m_lok);
+        return m_pending.size();
+    }
+
+    // 当前段文件数
+    size_t num_segments() {
+        std::lock_guard<std::mutex> lock(m_lok);
+        return m_segments.size();
+    }
+
+private:
+    static constexpr uint32_t record_magic = 0x52574c41; // "ALWR"
+    static constexpr uint32_t recordTask = 1;
+    static constexpr uint32_t recordDone = 2;
+
+    // 记录头；payload 紧随其后，整条记录按 8 字节对齐
+    struct recordHeader {
+        uint32_t magic;
+        uint32_t checksum; // 覆盖 id 之后的头部字段与 payload（FNV-1a），用于识别撕裂写
+        uint64_t id;
+        uint32_t type;
+        uint32_t kind;
+        uint32_t len;
+        uint32_t reserved;
+    };
+
+    struct segment {
+        uint64_t index = 0;
+        int fd = -1;
+        char *base = nullptr;
+        size_t size = 0;
+        size_t used = 0;    // 已追加字节数
+        size_t synced = 0;  // 已落盘字节数
+        uint64_t lsn = 0;   // 本段起始位置在全局日志中的偏移
+        size_t records = 0; // task 记录数
+        size_t live = 0;    // 尚未完成的 task 记录数
+        std::string path;
+
+        void unmap() {
+            if (base) munmap(base, size);
+            if (fd >= 0) ::close(fd);
+            base = nullptr;
+            fd = -1;
+        }
+    };
+
+    struct pendingTask {
+        uint64_t segment = 0; // task 记录所在段
+        uint32_t type = 0;
+        std::string args;
+    };
+
+    // 等待已提交到分支的任务结束，停止刷盘线程并解除所有段的映射
+    void close() {
+        {
+            std::unique_lock<std::mutex> lock(m_lok);
+            m_idle.wait(lock, [this] { return m_running == 0; });
+            m_stop = true;
+        }
+        m_work.notify_one();
+        m_flusher.reset(); // join（退出前做最后一次刷盘）
+        for (auto &seg : m_segments) seg->unmap();
+    }
+
+    static uint32_t checksum(const recordHeader &h, const char *payload) {
+        uint32_t x = 2166136261u;
+        auto mix = [&x](const char *p, size_t n) {
+            for (size_t i = 0; i < n; ++i) x = (x ^ static_cast<uint8_t>(p[i])) * 16777619u;
+        };
+        mix(reinterpret_cast<const char *>(&h.id), sizeof(recordHeader) - offsetof(recordHeader, id));
+        mix(payload, h.len);
+        return x;
+    }
+
+    static size_t record_bytes(size_t len) {
+        return (sizeof(recordHeader) + len + 7) & ~size_t(7);
+    }
+
+    std::string segment_path(uint64_t index) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "wal-%08llu.seg", static_cast<unsigned long long>(index));
+        return m_dir + "/" + name;
+    }
+
+    // 打开（或创建）段文件并映射
+    std::unique_ptr<segment> map_segment(uint64_t index, bool create) {
+        std::unique_ptr<segment> seg(new segment());
+        seg->index = index;
+        seg->path = segment_path(index);
+        seg->fd = ::open(seg->path.c_str(), create ? (O_CREAT | O_EXCL | O_RDWR) : O_RDWR, 0644);
+        if (seg->fd < 0) throw std::runtime_error("durablebranch: cannot open " + seg->path);
+        if (create) {
+            if (::ftruncate(seg->fd, static_cast<off_t>(m_segBytes)) != 0) {
+                throw std::runtime_error("durablebranch: cannot size " + seg->path);
+            }
+            sync_dir();
+        }
+        struct stat st;
+        ::fstat(seg->fd, &st);
+        seg->size = static_cast<size_t>(st.st_size);
+        void *p = mmap(nullptr, seg->size, PROT_READ | PROT_WRITE, MAP_SHARED, seg->fd, 0);
+        if (p == MAP_FAILED) throw std::runtime_error("durablebranch: mmap failed for " + seg->path);
+        seg->base = static_cast<char *>(p);
+        return seg;
+    }
+
+    // 目录项（段的创建与删除）落盘
+    void sync_dir() {
+        int dfd = ::open(m_dir.c_str(), O_RDONLY);
+        if (dfd >= 0) {
+            ::fsync(dfd);
+            ::close(dfd);
+        }
+    }
+
+    // 启动时重放所有段，返回需要重新执行的任务 id（按提交顺序）
+    std::vector<uint64_t> recover() {
+        std::vector<uint64_t> indexes;
+        if (DIR *d = ::opendir(m_dir.c_str())) {
+            while (dirent *e = ::readdir(d)) {
+                unsigned long long n;
+                char tail;
+                if (std::sscanf(e->d_name, "wal-%llu.se%c", &n, &tail) == 2 && tail == 'g') indexes.push_back(n);
+            }
+            ::closedir(d);
+        } else {
+            throw std::runtime_error("durablebranch: cannot open directory " + m_dir);
+        }
+        std::sort(indexes.begin(), indexes.end());
+        std::lock_guard<std::mutex> lock(m_lok);
+        for (uint64_t index : indexes) {
+            m_segments.push_back(map_segment(index, false));
+            segment &seg = *m_segments.back();
+            size_t off = 0;
+            while (off + sizeof(recordHeader) <= seg.size) {
+                recordHeader h;
+                std::memcpy(&h, seg.base + off, sizeof(h));
+                if (h.magic != record_magic || off + record_bytes(h.len) > seg.size) break;
+                const char *payload = seg.base + off + sizeof(recordHeader);
+                if (checksum(h, payload) != h.checksum) break; // 撕裂写：本段到此为止
+                if (h.kind == recordTask) {
+                    pendingTask &p = m_pending[h.id];
+                    p.segment = index;
+                    p.type = h.type;
+                    p.args.assign(payload, h.len);
+                    ++seg.records;
+                } else if (h.kind == recordDone) {
+                    m_pending.erase(h.id);
+                }
+                m_nextId = std::max(m_nextId, h.id + 1);
+                off += record_bytes(h.len);
+            }
+            seg.used = seg.synced = off;
+            seg.lsn = m_written;
+            m_written += seg.size;
+            m_durable = m_written;
+            m_nextSegment = index + 1;
+        }
+        recount();
+        std::vector<uint64_t> ids;
+        for (auto &kv : m_pending) ids.push_back(kv.first);
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+
+    // 按 m_pending 重新统计各段存活任务数（仅重放时使用）
+    void recount() {
+        for (auto &seg : m_segments) seg->live = 0;
+        for (auto &kv : m_pending) {
+            if (segment *seg = find_segment(kv.second.segment)) ++seg->live;
+        }
+    }
+
+    segment *find_segment(uint64_t index) {
+        for (auto &seg : m_segments) {
+            if (seg->index == index) return seg.get();
+        }
+        return nullptr;
+    }
+
+    // 新建当前段（调用方持有 m_lok）；旧段剩余部分视为已写满
+    void roll() {
+        if (!m_segments.empty()) {
+            segment &old = *m_segments.back();
+            m_written = old.lsn + old.size;
+        }
+        m_segments.push_back(map_segment(m_nextSegment++, true));
+        m_segments.back()->lsn = m_written;
+    }
+
+    // 追加一条记录（调用方持有 m_lok），返回记录末尾的全局偏移
+    uint64_t append(uint32_t kind, uint64_t id, uint32_t type, const std::string &payload) {
+        size_t need = record_bytes(payload.size());
+        if (need > m_segBytes) throw std::runtime_error("durablebranch: record larger than segment");
+        if (m_segments.back()->used + need > m_segments.back()->size) roll();
+        segment &seg = *m_segments.back();
+        recordHeader h;
+        h.magic = record_magic;
+        h.id = id;
+        h.type = type;
+        h.kind = kind;
+        h.len = static_cast<uint32_t>(payload.size());
+        h.reserved = 0;
+        h.checksum = checksum(h, payload.data());
+        char *dst = seg.base + seg.used;
+        std::memcpy(dst + sizeof(h), payload.data(), payload.size());
+        std::memcpy(dst, &h, sizeof(h));
+        seg.used += need;
+        if (kind == recordTask) ++seg.records;
+        m_written = seg.lsn + seg.used;
+        return m_written;
+    }
+
+    // 提交到分支执行，结束后追加 done 记录（调用方已为其递增 m_running）
+    void dispatch(uint64_t id, uint32_t type, const std::string &args) {
+        try {
+            submit_run(id, type, args);
+        } catch (...) {
+            // 分支已关闭：任务留在日志中，下次启动时重放
+            std::lock_guard<std::mutex> lock(m_lok);
+            if (--m_running == 0) m_idle.notify_all();
+            throw;
+        }
+    }
+
+    void submit_run(uint64_t id, uint32_t type, const std::string &args) {
+        m_branch.submit<cancel_aware>([this, id, type, args] {
+            // 被 abort 取消：不写 done 记录，任务留在日志中下次启动时重放
+            if (cancelling()) {
+                std::lock_guard<std::mutex> lock(m_lok);
+                if (--m_running == 0) m_idle.notify_all();
+                return;
+            }
+            std::string out;
+            if (!m_registry.invoke(type, args.data(), args.size(), out)) {
+                std::cerr << "durablebranch: task " << id << " failed:\n  what(): " << out << '\n' << std::flush;
+            }
+            std::lock_guard<std::mutex> lock(m_lok);
+            auto it = m_pending.find(id);
+            if (it != m_pending.end()) {
+                if (segment *seg = find_segment(it->second.segment)) --seg->live;
+                m_pending.erase(it);
+                append(recordDone, id, 0, std::string());
+                m_work.notify_one();
+            }
+            if (--m_running == 0) m_idle.notify_all();
+        });
+    }
+
+    // 刷盘线程：组提交 + 后台压缩
+    void flush_loop() {
+        std::unique_lock<std::mutex> lock(m_lok);
+        while (true) {
+            m_work.wait(lock, [this] { return m_stop || m_written > m_durable; });
+            flush(lock);
+            if (m_stop) break;
+            compact(lock);
+        }
+    }
+
+    // 把 [已落盘, 已写入) 区间 msync 到磁盘；期间释放锁，提交者可以继续追加（下一批）
+    void flush(std::unique_lock<std::mutex> &lock) {
+        uint64_t target = m_written;
+        std::vector<std::pair<segment *, std::pair<size_t, size_t>>> ranges;
+        for (auto &seg : m_segments) {
+            if (seg->used > seg->synced) ranges.push_back({seg.get(), {seg->synced, seg->used}});
+        }
+        lock.unlock();
+        static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        for (auto &r : ranges) {
+            size_t from = r.second.first & ~(page - 1);
+            msync(r.first->base + from, r.second.second - from, MS_SYNC);
+        }
+        lock.lock();
+        for (auto &r : ranges) r.first->synced = std::max(r.first->synced, r.second.second);
+        m_durable = std::max(m_durable, target);
+        m_durable_cv.notify_all();
+    }
+
+    // 处理最旧的非当前段：无存活任务则删除；存活比例低时搬迁存活任务后删除
+    void compact(std::unique_lock<std::mutex> &lock) {
+        while (m_segments.size() > 1) {
+            segment &old = *m_segments.front();
+            if (old.live > 0 && old.live * 4 > old.records) return;
+            if (old.live > 0) {
+                for (auto &kv : m_pending) {
+                    if (kv.second.segment != old.index) continue;
+                    append(recordTask, kv.first, kv.second.type, kv.second.args);
+                    kv.second.segment = m_segments.back()->index;
+                    ++m_segments.back()->live;
+                }
+                old.live = 0;
+                flush(lock); // 搬迁的记录落盘后才能删除旧段
+            }
+            std::unique_ptr<segment> dead = std::move(m_segments.front());
+            m_segments.pop_front();
+            dead->unmap();
+            ::unlink(dead->path.c_str());
+            sync_dir();
+        }
+    }
+
+private:
+    std::string m_dir;
+    workbranch &m_branch;
+    taskRegistry &m_registry;
+    size_t m_segBytes;
+
+    std::mutex m_lok;
+    std::condition_variable m_work;       // 唤醒刷盘线程
+    std::condition_variable m_durable_cv; // 刷盘完成，唤醒等待落盘的提交者
+    std::condition_variable m_idle;       // 执行中的任务归零（析构使用）
+    std::deque<std::unique_ptr<segment>> m_segments;
+    std::unordered_map<uint64_t, pendingTask> m_pending; // 尚未完成的任务
+    uint64_t m_nextId = 1;
+    uint64_t m_nextSegment = 0;
+    uint64_t m_written = 0; // 已写入的全局偏移
+    uint64_t m_durable = 0; // 已落盘的全局偏移
+    size_t m_running = 0;   // 已提交到分支尚未结束的任务数
+    bool m_stop = false;
+    std::unique_ptr<autoThread<join>> m_flusher;
+};
+
+} // namespace details
+
+// 便捷别名
+using durablebranch = details::durablebranch;
+
+} // namespace sunshine
+
+#endif // __unix__ || __APPLE__
@@ -0,0 +1,131 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace sunshine::details {
+
+/**
+ * @brief 多租户加权公平队列（Deficit Round Robin，单位任务代价）
+ *
+ * 每个租户一个子队列，活跃租户按轮询排列；轮到某租户时它最多连续出队 weight 个任务，
+ * 然后移到轮询尾部。入队/出队均为 O(1)，一个租户的突发只会拉长它自己的子队列。
+ */
+template <class T>
+class fairQueue {
+public:
+    using tenant_t = uint32_t;
+
+    // 单个租户的统计快照
+    struct tenantStats {
+        size_t depth = 0;      // 当前排队任务数
+        uint64_t enqueued = 0; // 累计入队数
+        uint64_t dequeued = 0; // 累计出队数（吞吐）
+        uint32_t weight = 1;   // 配置的份额
+    };
+
+private:
+    struct flow {
+        tenant_t id = 0;
+        std::deque<T> qu;
+        uint32_t weight = 1;
+        uint32_t deficit = 0; // 本轮剩余可出队数
+        bool active = false;  // 是否在轮询列表中
+        uint64_t enqueued = 0;
+        uint64_t dequeued = 0;
+    };
+
+public:
+    /**
+     * @brief 设置租户份额（至少为 1），未设置的租户份额为 1
+     */
+    void set_weight(tenant_t t, uint32_t w) {
+        std::lock_guard<std::mutex> lock(fqLock);
+        flows[t].weight = std::max<uint32_t>(w, 1);
+    }
+
+    void push_back(tenant_t t, T &&v) {
+        std::lock_guard<std::mutex> lock(fqLock);
+        flow &f = flows[t];
+        f.id = t;
+        f.qu.push_back(std::move(v));
+        ++f.enqueued;
+        if (!f.active) {
+            f.active = true;
+            f.deficit = 0;
+            ring.push_back(&f); // unordered_map 的元素地址在 rehash 后保持不变
+        }
+        total.fetch_add(1);
+    }
+
+    /**
+     * @brief 按 DRR 顺序出队一个任务
+     * @param who 非空时写入该任务所属租户
+     */
+    bool try_pop(T &v, tenant_t *who = nullptr) {
+        return try_pop(v, who, [](tenant_t) { return false; });
+    }
+
+    /**
+     * @brief 同上，但 throttled(tenant) 为真的租户被降级：轮询时跳过它们，
+     *        只有所有活跃租户都被降级时才照常出队（保持工作守恒）
+     */
+    template <class Pred>
+    bool try_pop(T &v, tenant_t *who, Pred &&throttled) {
+        // 空队列不加锁；漏看刚入队的任务只会推迟到下一轮，挂起前的检查使用 getLength()
+        if (total.load(std::memory_order_relaxed) == 0) return false;
+        std::lock_guard<std::mutex> lock(fqLock);
+        if (ring.empty()) return false;
+        for (size_t n = ring.size(); n > 1 && throttled(ring.front()->id); --n) {
+            flow *skipped = ring.front();
+            skipped->deficit = 0;
+            ring.pop_front();
+            ring.push_back(skipped);
+        }
+        flow *f = ring.front();
+        if (f->deficit == 0) f->deficit = f->weight; // 轮到该租户：补充本轮额度
+        v = std::move(f->qu.front());
+        f->qu.pop_front();
+        --f->deficit;
+        ++f->dequeued;
+        if (who) *who = f->id;
+        if (f->qu.empty()) {
+            f->active = false;
+            f->deficit = 0;
+            ring.pop_front();
+        } else if (f->deficit == 0) {
+            ring.pop_front();
+            ring.push_back(f);
+        }
+        total.fetch_sub(1);
+        return true;
+    }
+
+    // 所有租户的排队任务总数（无锁读取）；与 taskQueue 相同，读写均为 seq_cst，提交方与挂起的 worker 不会互相错过
+    size_t getLength() const {
+        return total.load();
+    }
+
+    tenantStats stats(tenant_t t) {
+        std::lock_guard<std::mutex> lock(fqLock);
+        tenantStats st;
+        auto it = flows.find(t);
+        if (it == flows.end()) return st;
+        st.depth = it->second.qu.size();
+        st.enqueued = it->second.enqueued;
+        st.dequeued = it->second.dequeued;
+        st.weight = it->second.weight;
+        return st;
+    }
+
+private:
+    std::mutex fqLock;
+    std::unordered_map<tenant_t, flow> flows;
+    std::deque<flow *> ring; // 活跃租户的轮询顺序
+    std::atomic<size_t> total = {0}; // 各子队列长度之和（在 fqLock 下修改）
+};
+
+} // namespace sunshine::details
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <vector>
+
+namespace sunshine {
+namespace details {
+
+// splitmix64 的终结函数：把 std::hash 的结果（整数类型通常是恒等映射）打散到整个 64 位空间
+inline uint64_t mix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+template <typename K>
+uint64_t key_hash(const K &key) {
+    return mix64(static_cast<uint64_t>(std::hash<K>{}(key)));
+}
+
+/**
+ * @brief 带虚拟节点的一致性哈希环，支持有界负载（consistent hashing with bounded loads）
+ *
+ * 每个节点按稳定的 id 在环上放置 vnodes 个虚拟节点；节点增删只影响约 1/N 的 key。
+ * pick 从 key 的位置顺时针查找第一个负载低于上限 max(ceil(c * (total + 1) / N), floor) 的节点：
+ * 热点 key 的归属节点过载时溢出到环上的后继节点，而不是无限堆积；floor 避免轻载时因取整过小而频繁溢出。
+ * 本类不加锁，由使用方保护。
+ */
+template <typename Node>
+class hashRing {
+public:
+    explicit hashRing(size_t vnodes = 64) :
+        vnodes(vnodes ? vnodes : 1) {
+    }
+
+    void add(Node node, uint64_t id) {
+        for (size_t i = 0; i < vnodes; ++i) ring[point(id, i)] = node;
+        nodes.push_back(node);
+    }
+
+    void remove(Node node, uint64_t id) {
+        for (size_t i = 0; i < vnodes; ++i) {
+            auto it = ring.find(point(id, i));
+            if (it != ring.end() && it->second == node) ring.erase(it);
+        }
+        for (auto it = nodes.begin(); it != nodes.end(); ++it) {
+            if (*it == node) {
+                nodes.erase(it);
+                break;
+            }
+        }
+    }
+
+    bool empty() const {
+        return nodes.empty();
+    }
+
+    size_t size() const {
+        return nodes.size();
+    }
+
+    /**
+     * @brief 为哈希值 h 选择节点
+     * @param balance 负载上限系数 c（>= 1，越大越偏向归属节点）
+     * @param total 所有节点的负载之和
+     * @param load load(Node) 返回节点当前负载
+     * @param floor 上限的最小值：负载低于它的节点总被视为未过载
+     * @return 选中的节点；环为空时返回 Node{}
+     */
+    template <typename Load>
+    Node pick(uint64_t h, double balance, size_t total, Load &&load, size_t floor = 1) const {
+        if (nodes.empty()) return Node{};
+        double cap = std::ceil(balance * static_cast<double>(total + 1) / static_cast<double>(nodes.size()));
+        cap = std::max(cap, static_cast<double>(floor));
+        // 顺时针返回第一个未超限的虚拟节点，不记录已访问的节点：路由路径上不分配内存，
+        // 同一过载节点被再次遇到时只多一次 load() 调用；上限不小于平均负载，通常几步内即可找到
+        auto home = ring.lower_bound(h);
+        if (home == ring.end()) home = ring.begin();
+        auto it = home;
+        for (size_t step = 0; step < ring.size(); ++step) {
+            if (static_cast<double>(load(it->second)) < cap) return it->second;
+            if (++it == ring.end()) it = ring.begin();
+        }
+        // 上限不小于平均负载，不会全部超限；保险起见退回归属节点
+        return home->second;
+    }
+
+private:
+    // id 先加盐打散再叠加序号：key_hash 同样是 mix64，否则小整数 key 会与编号 0 的虚拟节点位置重合
+    uint64_t point(uint64_t id, size_t i) const {
+        return mix64(mix64(id ^ 0x632be59bd9b4e019ull) + i);
+    }
+
+private:
+    size_t vnodes;
+    std::map<uint64_t, Node> ring;
+    std::vector<Node> nodes;
+};
+
+} // namespace details
+} // namespace sunshine
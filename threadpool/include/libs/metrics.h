@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace sunshine {
+namespace details {
+
+/**
+ * @brief 无锁的对数-线性直方图，用于记录耗时分布（单位：纳秒）
+ *
+ * 每个 2 的幂区间再等分为 sub_buckets 份，分位数误差不超过 1 / sub_buckets。
+ * record() 只有一次 relaxed fetch_add，可在 worker 热路径上使用。
+ */
+class latencyHistogram {
+public:
+    static constexpr size_t sub_bits = 3;
+    static constexpr size_t sub_buckets = size_t(1) << sub_bits;
+    static constexpr size_t bucket_count = (64 - sub_bits + 1) * sub_buckets;
+
+    void record(uint64_t ns) noexcept {
+        buckets[index(ns)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void record(std::chrono::nanoseconds d) noexcept {
+        record(d.count() > 0 ? static_cast<uint64_t>(d.count()) : 0);
+    }
+
+    uint64_t count() const noexcept {
+        uint64_t n = 0;
+        for (auto &b : buckets) n += b.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    /**
+     * @brief 返回 p 分位（0 < p <= 1）所在桶的上界；没有样本时返回 0
+     */
+    std::chrono::nanoseconds percentile(double p) const noexcept {
+        uint64_t total = count();
+        if (total == 0) return std::chrono::nanoseconds(0);
+        uint64_t target = static_cast<uint64_t>(p * static_cast<double>(total));
+        if (target == 0) target = 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < bucket_count; ++i) {
+            seen += buckets[i].load(std::memory_order_relaxed);
+            if (seen >= target) return std::chrono::nanoseconds(lower(i + 1));
+        }
+        return std::chrono::nanoseconds(lower(bucket_count));
+    }
+
+    void reset() noexcept {
+        for (auto &b : buckets) b.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static size_t msb(uint64_t v) noexcept {
+#if defined(_MSC_VER)
+        unsigned long idx;
+        _BitScanReverse64(&idx, v);
+        return idx;
+#else
+        return 63 - static_cast<size_t>(__builtin_clzll(v));
+#endif
+    }
+
+    static size_t index(uint64_t v) noexcept {
+        if (v < sub_buckets) return static_cast<size_t>(v);
+        size_t m = msb(v);
+        size_t shift = m - sub_bits;
+        return (m - sub_bits + 1) * sub_buckets + static_cast<size_t>((v >> shift) & (sub_buckets - 1));
+    }
+
+    // 桶 i 的下界（即桶 i - 1 的上界）
+    static int64_t lower(size_t i) noexcept {
+        if (i < 2 * sub_buckets) return static_cast<int64_t>(i);
+        size_t octave = i / sub_buckets;
+        size_t shift = octave - 1;
+        if (shift + sub_bits >= 63) return INT64_MAX;
+        return static_cast<int64_t>((sub_buckets + i % sub_buckets) << shift);
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, bucket_count> buckets = {};
+};
+
+} // namespace details
+} // namespace sunshine
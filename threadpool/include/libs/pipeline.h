@@ -0,0 +1,314 @@
+#pragma once
+
+#include "libs/utility.h"
+#include "libs/workbranch.h"
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sunshine {
+
+/// 流水线阶段的执行方式（与 TBB parallel_pipeline 的 filter 模式对应）
+enum class stageMode {
+    serial_in_order,     // 串行，且按源产生的顺序处理
+    serial_out_of_order, // 串行，按到达顺序处理
+    parallel             // 可并发处理多个元素
+};
+
+namespace details {
+
+/**
+ * @brief 流水线的类型擦除执行核心
+ *
+ * 源（串行）每产生一个元素占用一个令牌，元素走完所有阶段后归还；令牌数限制在途元素数，从而限制内存。
+ * 一个任务携带一个元素尽量连续地穿过各阶段：并行阶段直接执行；串行阶段空闲（且对按序阶段而言轮到该元素）
+ * 时直接执行，否则把元素放入该阶段的缓冲区（按序阶段为按序号排序的重排缓冲区）后结束任务，
+ * 由该阶段当前的执行者处理完后取出下一个可执行元素，提交新任务继续推进。
+ */
+class pipelineCore : public std::enable_shared_from_this<pipelineCore> {
+public:
+    using erased = std::unique_ptr<void, void (*)(void *)>;
+
+    template <typename T>
+    static erased erase(T &&v) {
+        using U = std::decay_t<T>;
+        return erased(new U(std::forward<T>(v)), [](void *p) { delete static_cast<U *>(p); });
+    }
+
+    static erased empty() {
+        return erased(nullptr, [](void *) {});
+    }
+
+    using sourceFn = std::function<bool(erased &)>; // 产生一个元素；返回 false 表示源已耗尽
+    using stageFn = std::function<void(erased &)>;  // 原地把元素变换为下一阶段的输入
+
+    pipelineCore(workbranch &wb, size_t tokens, sourceFn src) :
+        m_branch(wb), m_tokens(tokens ? tokens : 1), m_source(std::move(src)) {
+    }
+
+    void add_stage(stageMode mode, stageFn fn) {
+        m_stages.emplace_back(new stage());
+        m_stages.back()->mode = mode;
+        m_stages.back()->fn = std::move(fn);
+    }
+
+    std::future<void> run() {
+        if (m_started) throw std::logic_error("pipeline: run() called twice");
+        m_started = true;
+        auto fut = m_done.get_future();
+        auto self = shared_from_this();
+        m_branch.submit([self] { self->pump(); });
+        return fut;
+    }
+
+private:
+    struct item {
+        uint64_t seq = 0;
+        erased value = empty();
+        bool failed = false; // 之前的阶段抛出异常：后续阶段只做顺序簿记，不再执行
+    };
+
+    struct stage {
+        stageMode mode = stageMode::parallel;
+        stageFn fn;
+        std::mutex lok;
+        bool busy = false;                 // 串行阶段是否有执行者
+        uint64_t next_seq = 0;             // 按序阶段下一个应处理的序号
+        std::map<uint64_t, item> reorder;  // 按序阶段的重排缓冲区
+        std::deque<item> fifo;             // 乱序串行阶段的等待队列
+    };
+
+    // 在令牌允许时反复运行源，并把产生的元素推进到各阶段；元素走完所有阶段后在本栈帧内继续取下一个，
+    // 不经由 retire 递归（令牌很少、元素很多时递归会耗尽栈）
+    void pump() {
+        while (true) {
+            item it;
+            if (!produce(it)) return;
+            if (!advance(0, std::move(it), false) || !retire()) return;
+        }
+    }
+
+    // 令牌允许时从源取一个元素；返回 false 表示没有取到（源正被占用、令牌用尽或源已耗尽）
+    bool produce(item &it) {
+        {
+            std::lock_guard<std::mutex> lock(m_lok);
+            if (m_srcBusy || m_exhausted || m_inflight >= m_tokens) return false;
+            m_srcBusy = true;
+            ++m_inflight;
+        }
+        bool produced = false;
+        try {
+            produced = m_source(it.value);
+        } catch (...) {
+            fail(std::current_exception());
+        }
+        bool more;
+        {
+            std::lock_guard<std::mutex> lock(m_lok);
+            m_srcBusy = false;
+            if (!produced) {
+                m_exhausted = true;
+                --m_inflight;
+                finish_if_drained();
+                return false;
+            }
+            it.seq = m_nextSeq++;
+            more = !m_exhausted && m_inflight < m_tokens;
+        }
+        // 还有令牌：另起一个任务继续从源取元素，本任务带着当前元素往下走
+        if (more) {
+            auto self = shared_from_this();
+            m_branch.submit([self] { self->pump(); });
+        }
+        return true;
+    }
+
+    // 从第 k 个阶段开始推进元素；owned 表示已持有第 k 个（串行）阶段的执行权
+    // 返回 true 表示元素已走完所有阶段（调用方负责 retire），false 表示元素被放入某个串行阶段的缓冲区
+    bool advance(size_t k, item it, bool owned) {
+        for (; k < m_stages.size(); ++k) {
+            stage &s = *m_stages[k];
+            if (s.mode != stageMode::parallel && !owned) {
+                std::lock_guard<std::mutex> lock(s.lok);
+                bool turn = s.mode == stageMode::serial_out_of_order || it.seq == s.next_seq;
+                if (s.busy || !turn) {
+                    if (s.mode == stageMode::serial_in_order) {
+                        uint64_t seq = it.seq;
+                        s.reorder.emplace(seq, std::move(it));
+                    } else {
+                        s.fifo.push_back(std::move(it));
+                    }
+                    return false;
+                }
+                s.busy = true;
+            }
+            owned = false;
+            execute(s, it);
+            if (s.mode != stageMode::parallel) release(k);
+        }
+        return true;
+    }
+
+    void execute(stage &s, item &it) {
+        if (it.failed) return;
+        try {
+            s.fn(it.value);
+        } catch (...) {
+            it.failed = true;
+            it.value = empty();
+            fail(std::current_exception());
+        }
+    }
+
+    // 串行阶段处理完一个元素：把执行权交给下一个可执行的缓冲元素（提交新任务），否则置为空闲
+    void release(size_t k) {
+        stage &s = *m_stages[k];
+        item next;
+        {
+            std::lock_guard<std::mutex> lock(s.lok);
+            if (s.mode == stageMode::serial_in_order) {
+                ++s.next_seq;
+                auto found = s.reorder.find(s.next_seq);
+                if (found == s.reorder.end()) {
+                    s.busy = false;
+                    return;
+                }
+                next = std::move(found->second);
+                s.reorder.erase(found);
+            } else {
+                if (s.fifo.empty()) {
+                    s.busy = false;
+                    return;
+                }
+                next = std::move(s.fifo.front());
+                s.fifo.pop_front();
+            }
+        }
+        auto self = shared_from_this();
+        auto carried = std::make_shared<item>(std::move(next));
+        m_branch.submit([self, k, carried] {
+            if (self->advance(k, std::move(*carried), true) && self->retire()) self->pump();
+        });
+    }
+
+    // 元素走完所有阶段：归还令牌；返回调用方是否应继续从源取元素（源已耗尽时检查是否全部完成）
+    bool retire() {
+        std::lock_guard<std::mutex> lock(m_lok);
+        --m_inflight;
+        if (m_exhausted) {
+            finish_if_drained();
+            return false;
+        }
+        return true;
+    }
+
+    // 记录第一个异常，并停止从源取新元素
+    void fail(std::exception_ptr ex) {
+        std::lock_guard<std::mutex> lock(m_lok);
+        if (!m_error) m_error = ex;
+        m_exhausted = true;
+    }
+
+    // 调用方持有 m_lok
+    void finish_if_drained() {
+        if (m_inflight != 0 || m_finished) return;
+        m_finished = true;
+        if (m_error) {
+            m_done.set_exception(m_error);
+        } else {
+            m_done.set_value();
+        }
+    }
+
+private:
+    workbranch &m_branch;
+    size_t m_tokens;
+    sourceFn m_source;
+    std::vector<std::unique_ptr<stage>> m_stages;
+
+    std::mutex m_lok;        // 保护源与令牌状态
+    bool m_srcBusy = false;  // 源是否正在运行（源总是串行）
+    bool m_exhausted = false;
+    bool m_started = false;
+    bool m_finished = false;
+    size_t m_inflight = 0;   // 已从源取出、尚未走完所有阶段的元素数
+    uint64_t m_nextSeq = 0;
+    std::exception_ptr m_error;
+    std::promise<void> m_done;
+};
+
+/**
+ * @brief 流水线构建器：T 为当前最后一个阶段的输出类型
+ */
+template <typename T>
+class pipeline {
+public:
+    explicit pipeline(std::shared_ptr<pipelineCore> c) :
+        core(std::move(c)) {
+    }
+
+    /**
+     * @brief 追加一个阶段：f(T) 的返回值作为下一阶段的输入；返回 void 的阶段只能是最后一个
+     */
+    template <typename F, typename R = result_of_t<F, T>>
+    auto then(stageMode mode, F &&f) -> pipeline<R> {
+        static_assert(!std::is_void<T>::value, "pipeline: cannot add a stage after a stage returning void");
+        core->add_stage(mode, [fn = std::decay_t<F>(std::forward<F>(f))](pipelineCore::erased &v) mutable {
+            T &in = *static_cast<T *>(v.get());
+            if constexpr (std::is_void<R>::value) {
+                fn(std::move(in));
+                v = pipelineCore::empty();
+            } else {
+                v = pipelineCore::erase(fn(std::move(in)));
+            }
+        });
+        return pipeline<R>(core);
+    }
+
+    /**
+     * @brief 启动流水线；所有元素处理完（或某阶段抛出异常后在途元素排空）时 future 就绪
+     * @note 不要在同一分支的 worker 中等待该 future
+     */
+    std::future<void> run() {
+        return core->run();
+    }
+
+private:
+    std::shared_ptr<pipelineCore> core;
+};
+
+/**
+ * @brief 创建流水线
+ * @param tokens 最多同时在途的元素数
+ * @param source 串行调用的源：返回 std::optional<T>，std::nullopt 表示结束
+ */
+template <typename F, typename O = result_of_t<F>, typename T = typename O::value_type>
+auto make_pipeline(workbranch &wb, size_t tokens, F &&source) -> pipeline<T> {
+    auto src = [fn = std::decay_t<F>(std::forward<F>(source))](pipelineCore::erased &out) mutable {
+        O v = fn();
+        if (!v) return false;
+        out = pipelineCore::erase(std::move(*v));
+        return true;
+    };
+    return pipeline<T>(std::make_shared<pipelineCore>(wb, tokens, std::move(src)));
+}
+
+} // namespace details
+
+// 便捷别名
+template <typename T>
+using pipeline = details::pipeline<T>;
+using details::make_pipeline;
+
+} // namespace sunshine
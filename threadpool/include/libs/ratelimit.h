@@ -0,0 +1,117 @@
+#pragma once
+
+#include "libs/timer.h"
+#include "libs/tokenbucket.h"
+#include "libs/utility.h"
+#include "libs/workbranch.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace sunshine {
+namespace details {
+
+/**
+ * @brief 一类任务的速率限制器：同一限制器提交的任务（可以分布在不同的 workbranch 上）
+ *        合计不超过 rate 个/秒开始排队执行，突发最多 burst 个
+ *
+ * 提交时从令牌桶预订一个令牌：有令牌则立即提交到分支；超出速率的任务按预订到的时刻交给 timer，
+ * 到期后才进入分支队列，等待期间不占用 worker 也不占用队列位置。
+ * 限制的是进入分支的速率；若还需限制分支整体的执行速率，见 workbranch::set_rate_limit。
+ *
+ * 注意：workbranch / timer 的生命周期必须长于所有已延后的任务（限制器本身可以先析构）。
+ */
+class rate_limiter {
+private:
+    // 定时器回调持有 shared_ptr，限制器析构后已延后的任务仍会按时提交
+    struct state {
+        tokenBucket bucket;
+        std::atomic<size_t> deferred = {0};
+        std::atomic<uint64_t> delayed = {0};
+    };
+
+public:
+    rate_limiter(double rate, double burst, timer &tm) :
+        m_state(std::make_shared<state>()), m_timer(tm) {
+        m_state->bucket.configure(rate, burst);
+    }
+
+    rate_limiter(const rate_limiter &) = delete;
+    rate_limiter(rate_limiter &&) = delete;
+
+    /**
+     * @brief 按限速把 void 任务提交到 wb
+     */
+    template <typename F, typename R = result_of_t<F>,
+              typename DR = typename std::enable_if<std::is_void<R>::value>::type>
+    void submit(workbranch &wb, F &&task) {
+        dispatch(wb, std::forward<F>(task));
+    }
+
+    /**
+     * @brief 按限速把返回值任务提交到 wb；任务被延后时 future 同样要等到执行完才就绪
+     */
+    template <typename F, typename R = result_of_t<F>,
+              typename DR = typename std::enable_if<!std::is_void<R>::value, R>::type>
+    auto submit(workbranch &wb, F &&task) -> std::future<R> {
+        auto task_promise = std::make_shared<std::promise<R>>();
+        auto fut = task_promise->get_future();
+        dispatch(wb, [exec = std::decay_t<F>(std::forward<F>(task)), task_promise]() mutable {
+            try {
+                fulfil(*task_promise, exec);
+            } catch (...) {
+                task_promise->set_exception(std::current_exception());
+            }
+        });
+        return fut;
+    }
+
+    /**
+     * @brief 调整速率与突发容量；rate <= 0 取消限速（已延后的任务仍按原时刻提交）
+     */
+    void set_rate(double rate, double burst = 1) {
+        m_state->bucket.configure(rate, burst);
+    }
+
+    // 正在 timer 上等待的任务数
+    size_t num_deferred() const {
+        return m_state->deferred.load(std::memory_order_relaxed);
+    }
+
+    // 累计被延后的任务数
+    uint64_t num_delayed() const {
+        return m_state->delayed.load(std::memory_order_relaxed);
+    }
+
+private:
+    template <typename F>
+    void dispatch(workbranch &wb, F &&task) {
+        auto wait = m_state->bucket.reserve();
+        if (wait <= timer::clock::duration::zero()) {
+            wb.submit(std::forward<F>(task));
+            return;
+        }
+        m_state->deferred.fetch_add(1, std::memory_order_relaxed);
+        m_state->delayed.fetch_add(1, std::memory_order_relaxed);
+        // 分支已 shutdown 时 submit 抛出的异常由 timer 记录
+        m_timer.add(wait, [st = m_state, &wb, fn = std::decay_t<F>(std::forward<F>(task))]() mutable {
+            st->deferred.fetch_sub(1, std::memory_order_relaxed);
+            wb.submit(std::move(fn));
+        });
+    }
+
+private:
+    std::shared_ptr<state> m_state;
+    timer &m_timer;
+};
+
+} // namespace details
+
+// 便捷别名
+using rate_limiter = details::rate_limiter;
+
+} // namespace sunshine
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace sunshine {
+namespace details {
+
+/**
+ * @brief 跨进程任务参数/结果的编解码
+ *
+ * 默认按字节拷贝，只支持平凡可复制类型；std::string 按原始字节传输。
+ * 需要其他类型时特化 codec<T>，提供 encode(const T&, std::string&) 与 decode(const char*, size_t)。
+ */
+template <typename T, typename = void>
+struct codec {
+    static_assert(std::is_trivially_copyable<T>::value, "codec: type must be trivially copyable or specialize codec<T>");
+
+    static void encode(const T &v, std::string &out) {
+        out.append(reinterpret_cast<const char *>(&v), sizeof(T));
+    }
+
+    static T decode(const char *data, size_t len) {
+        if (len != sizeof(T)) throw std::runtime_error("codec: payload size mismatch");
+        T v;
+        std::memcpy(&v, data, sizeof(T));
+        return v;
+    }
+};
+
+template <>
+struct codec<std::string> {
+    static void encode(const std::string &v, std::string &out) {
+        out.append(v);
+    }
+
+    static std::string decode(const char *data, size_t len) {
+        return std::string(data, len);
+    }
+};
+
+/**
+ * @brief 可远程执行的任务类型表（服务端进程使用）
+ *
+ * 每种任务类型用一个 32 位 id 标识，客户端只传 id 与编码后的参数；
+ * 服务端按 id 找到处理函数，解码参数、执行并编码结果。处理函数抛出的异常以消息文本传回客户端。
+ */
+class taskRegistry {
+public:
+    // 处理函数：输入编码后的参数，输出编码后的结果
+    using handler_t = std::function<void(const char *data, size_t len, std::string &out)>;
+
+    /**
+     * @brief 注册任务类型
+     * @tparam Args 参数类型（需可被 codec 编解码）
+     * @param fn 形如 R(const Args&) 的可调用对象；R 可以为 void
+     */
+    template <typename Args, typename F>
+    void add(uint32_t type, F &&fn) {
+        using R = std::decay_t<decltype(fn(std::declval<const Args &>()))>;
+        handler_t h = [fn = std::decay_t<F>(std::forward<F>(fn))](const char *data, size_t len, std::string &out) {
+            Args args = codec<Args>::decode(data, len);
+            if constexpr (std::is_void<R>::value) {
+                fn(args);
+            } else {
+                codec<R>::encode(fn(args), out);
+            }
+        };
+        std::lock_guard<std::mutex> lock(rgLock);
+        handlers[type] = std::move(h);
+    }
+
+    /**
+     * @brief 执行一个请求
+     * @return 处理函数正常返回时为 true，out 为编码后的结果；否则为 false，out 为错误消息
+     */
+    bool invoke(uint32_t type, const char *data, size_t len, std::string &out) {
+        handler_t h;
+        {
+            std::lock_guard<std::mutex> lock(rgLock);
+            auto it = handlers.find(type);
+            if (it == handlers.end()) {
+                out = "unknown task type " + std::to_string(type);
+                return false;
+            }
+            h = it->second;
+        }
+        try {
+            h(data, len, out);
+            return true;
+        } catch (const std::exception &ex) {
+            out = ex.what();
+        } catch (...) {
+            out = "unknown exception";
+        }
+        return false;
+    }
+
+private:
+    std::mutex rgLock;
+    std::unordered_map<uint32_t, handler_t> handlers;
+};
+
+/**
+ * @brief 进程外分支的公共基类（客户端进程使用）
+ *
+ * 负责请求编号与在途请求表：submit 编码参数并交给派生类的 send() 发送，
+ * 派生类收到响应后调用 resolve() 兑现对应的 future。传输方式（共享内存、Unix 域套接字等）由派生类实现。
+ */
+class remoteBranch {
+public:
+    remoteBranch() = default;
+    remoteBranch(const remoteBranch &) = delete;
+    remoteBranch(remoteBranch &&) = delete;
+
+    virtual ~remoteBranch() = default;
+
+    /**
+     * @brief 提交一个已在服务端注册的任务
+     * @tparam R 结果类型（与服务端处理函数的返回值一致，可以为 void）
+     * @return 服务端处理函数抛出异常、或连接关闭时，future 以 std::runtime_error 失败
+     */
+    template <typename R, typename Args>
+    auto submit(uint32_t type, const Args &args) -> std::future<R> {
+        std::string payload;
+        codec<Args>::encode(args, payload);
+        auto task_promise = std::make_shared<std::promise<R>>();
+        auto fut = task_promise->get_future();
+        uint64_t seq;
+        {
+            std::lock_guard<std::mutex> lock(rbLock);
+            if (closed) throw std::runtime_error("remote branch: connection closed");
+            seq = ++next_seq;
+            pending.emplace(seq, [task_promise](bool ok, const char *data, size_t len) {
+                try {
+                    if (!ok) throw std::runtime_error("remote task failed: " + std::string(data, len));
+                    if constexpr (std::is_void<R>::value) {
+                        task_promise->set_value();
+                    } else {
+                        task_promise->set_value(codec<R>::decode(data, len));
+                    }
+                } catch (...) {
+                    task_promise->set_exception(std::current_exception());
+                }
+            });
+            inflight.store(pending.size(), std::memory_order_relaxed);
+        }
+        try {
+            send(seq, type, payload);
+        } catch (...) {
+            // 发送失败：撤回登记，直接以异常返回
+            resolve(seq, false, "send failed", 11);
+            throw;
+        }
+        return fut;
+    }
+
+    // 已发送但尚未收到响应的请求数（无锁读取，用于负载比较）
+    size_t num_tasks() const noexcept {
+        return inflight.load(std::memory_order_relaxed);
+    }
+
+protected:
+    // 发送一个请求；可以阻塞（背压），失败时抛出异常
+    virtual void send(uint64_t seq, uint32_t type, const std::string &payload) = 0;
+
+    // 收到 seq 的响应：ok 为真时 data 为编码后的结果，否则为错误消息
+    void resolve(uint64_t seq, bool ok, const char *data, size_t len) {
+        std::function<void(bool, const char *, size_t)> done;
+        {
+            std::lock_guard<std::mutex> lock(rbLock);
+            auto it = pending.find(seq);
+            if (it == pending.end()) return;
+            done = std::move(it->second);
+            pending.erase(it);
+            inflight.store(pending.size(), std::memory_order_relaxed);
+        }
+        done(ok, data, len);
+    }
+
+    // 连接断开：拒绝后续提交，所有在途请求以 msg 失败
+    void fail_all(const std::string &msg) {
+        std::unordered_map<uint64_t, std::function<void(bool, const char *, size_t)>> orphans;
+        {
+            std::lock_guard<std::mutex> lock(rbLock);
+            closed = true;
+            orphans.swap(pending);
+            inflight.store(0, std::memory_order_relaxed);
+        }
+        for (auto &kv : orphans) kv.second(false, msg.data(), msg.size());
+    }
+
+private:
+    std::mutex rbLock;
+    std::unordered_map<uint64_t, std::function<void(bool, const char *, size_t)>> pending; // 在途请求
+    uint64_t next_seq = 0;
+    bool closed = false;
+    std::atomic<size_t> inflight = {0};
+};
+
+} // namespace details
+
+// 便捷别名
+using taskRegistry = details::taskRegistry;
+using remoteBranch = details::remoteBranch;
+
+} // namespace sunshine
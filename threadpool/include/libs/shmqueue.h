@@ -0,0 +1,473 @@
+#pragma once
+
+// 共享内存跨进程任务队列（仅 Linux：依赖 memfd / shm_open、mmap 与 futex）
+#if defined(__linux__)
+
+#include "libs/autothread.h"
+#include "libs/remote.h"
+#include "libs/workbranch.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+namespace sunshine {
+namespace details {
+
+// 定长任务描述符：请求与响应共用（256 字节）
+struct shmDesc {
+    static constexpr size_t payload_size = 236;
+
+    uint64_t seq = 0;    // 客户端请求编号
+    uint32_t type = 0;   // 任务类型 id
+    uint32_t len = 0;    // payload 有效字节数
+    uint32_t status = 0; // 响应：0 成功，1 失败（payload 为错误消息）
+    char payload[payload_size];
+};
+
+// 环形队列头部（位于共享内存中，所有字段必须是地址无关的无锁原子量）
+struct shmRingHeader {
+    alignas(64) std::atomic<uint64_t> head;  // 下一个入队位置
+    alignas(64) std::atomic<uint64_t> tail;  // 下一个出队位置
+    alignas(64) std::atomic<uint32_t> items; // futex 字：每次入队递增
+    std::atomic<uint32_t> item_waiters;      // 等待出队的线程数
+    std::atomic<uint32_t> spaces;            // futex 字：每次出队递增
+    std::atomic<uint32_t> space_waiters;     // 等待入队的线程数
+    std::atomic<uint32_t> closed;            // 关闭后入队失败，出队在队列空时失败
+};
+
+struct shmCell {
+    std::atomic<uint64_t> seq; // Vyukov 序号：等于位置时可写，等于位置 + 1 时可读
+    shmDesc desc;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "shmqueue: atomics in shared memory must be lock-free");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "shmqueue: futex word must be 32 bits");
+
+/**
+ * @brief 共享内存中的有界 MPMC 无锁环形队列（Vyukov 算法）的进程内视图
+ *
+ * 入队/出队本身无锁；队列空或满时调用方通过 futex 挂起（不带 FUTEX_PRIVATE_FLAG，可跨进程唤醒），
+ * 只有存在等待者时才发起 FUTEX_WAKE 系统调用。
+ */
+class shmRing {
+public:
+    shmRing() = default;
+    shmRing(shmRingHeader *h, shmCell *c, uint32_t capacity) :
+        hdr(h), cells(c), mask(capacity - 1) {
+    }
+
+    // 在新建的共享内存上初始化队列（capacity 必须是 2 的幂）
+    static void init(shmRingHeader *h, shmCell *c, uint32_t capacity) {
+        new (h) shmRingHeader();
+        h->head.store(0);
+        h->tail.store(0);
+        h->items.store(0);
+        h->item_waiters.store(0);
+        h->spaces.store(0);
+        h->space_waiters.store(0);
+        h->closed.store(0);
+        for (uint32_t i = 0; i < capacity; ++i) {
+            new (&c[i]) shmCell();
+            c[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool try_push(const shmDesc &d) {
+        uint64_t pos = hdr->head.load(std::memory_order_relaxed);
+        shmCell *cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            uint64_t seq = cell->seq.load(std::memory_order_acquire);
+            int64_t dif = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+            if (dif == 0) {
+                if (hdr->head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (dif < 0) {
+                return false; // 满
+            } else {
+                pos = hdr->head.load(std::memory_order_relaxed);
+            }
+        }
+        cell->desc = d;
+        cell->seq.store(pos + 1, std::memory_order_release);
+        signal(hdr->items, hdr->item_waiters);
+        return true;
+    }
+
+    bool try_pop(shmDesc &d) {
+        uint64_t pos = hdr->tail.load(std::memory_order_relaxed);
+        shmCell *cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            uint64_t seq = cell->seq.load(std::memory_order_acquire);
+            int64_t dif = static_cast<int64_t>(seq) - static_cast<int64_t>(pos + 1);
+            if (dif == 0) {
+                if (hdr->tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (dif < 0) {
+                return false; // 空
+            } else {
+                pos = hdr->tail.load(std::memory_order_relaxed);
+            }
+        }
+        d = cell->desc;
+        cell->seq.store(pos + mask + 1, std::memory_order_release);
+        signal(hdr->spaces, hdr->space_waiters);
+        return true;
+    }
+
+    // 阻塞入队：队列满时挂起；队列已关闭时返回 false
+    bool push(const shmDesc &d) {
+        while (!closed()) {
+            uint32_t epoch = hdr->spaces.load(std::memory_order_acquire);
+            if (try_push(d)) return true;
+            if (await(hdr->spaces, hdr->space_waiters, epoch, [&] { return try_push(d); })) return true;
+        }
+        return false;
+    }
+
+    // 阻塞出队：队列空时挂起；队列已关闭且为空时返回 false
+    bool pop(shmDesc &d) {
+        while (true) {
+            uint32_t epoch = hdr->items.load(std::memory_order_acquire);
+            if (try_pop(d)) return true;
+            if (closed()) return false;
+            if (await(hdr->items, hdr->item_waiters, epoch, [&] { return try_pop(d); })) return true;
+        }
+    }
+
+    // 关闭队列并唤醒两侧所有等待者
+    void close() {
+        hdr->closed.store(1);
+        hdr->items.fetch_add(1);
+        hdr->spaces.fetch_add(1);
+        futex_wake(hdr->items);
+        futex_wake(hdr->spaces);
+    }
+
+    bool closed() const {
+        return hdr->closed.load(std::memory_order_acquire) != 0;
+    }
+
+    size_t getLength() const {
+        uint64_t h = hdr->head.load(std::memory_order_relaxed);
+        uint64_t t = hdr->tail.load(std::memory_order_relaxed);
+        return h > t ? static_cast<size_t>(h - t) : 0;
+    }
+
+private:
+    // 状态变化后：推进 futex 字，有等待者时才唤醒
+    // 两侧的 seq_cst fence 构成 Dekker 式配对，保证「对方已挂起」与「本方已发布」至少一方可见
+    static void signal(std::atomic<uint32_t> &word, std::atomic<uint32_t> &waiters) {
+        word.fetch_add(1, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters.load(std::memory_order_relaxed) > 0) futex_wake(word);
+    }
+
+    // 登记为等待者后再试一次（成功则返回 true），仍失败则在 word 仍为 epoch 时挂起（超时兜底，以便观察关闭）
+    template <typename Retry>
+    bool await(std::atomic<uint32_t> &word, std::atomic<uint32_t> &waiters, uint32_t epoch, Retry &&retry) {
+        waiters.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool done = retry();
+        if (!done && !closed()) {
+            timespec ts = {0, 100 * 1000 * 1000};
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, epoch, &ts, nullptr, 0);
+        }
+        waiters.fetch_sub(1, std::memory_order_relaxed);
+        return done;
+    }
+
+    static void futex_wake(std::atomic<uint32_t> &word) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+    }
+
+private:
+    shmRingHeader *hdr = nullptr;
+    shmCell *cells = nullptr;
+    uint64_t mask = 0;
+};
+
+// 共享内存段：一个请求队列（客户端 -> 服务端）与一个响应队列（服务端 -> 客户端）
+class shmSegment {
+public:
+    static constexpr uint32_t magic_word = 0x53484d51; // "SHMQ"
+
+    struct header {
+        uint32_t magic;
+        uint32_t capacity;
+        std::atomic<uint32_t> attached; // 是否已有客户端连接（一个段只服务一个客户端）
+        shmRingHeader req;
+        shmRingHeader rsp;
+    };
+
+    static size_t bytes(uint32_t capacity) {
+        return sizeof(header) + 2 * sizeof(shmCell) * capacity;
+    }
+
+    shmSegment() = default;
+    shmSegment(const shmSegment &) = delete;
+
+    ~shmSegment() {
+        if (base) munmap(base, size);
+        if (fd >= 0) ::close(fd);
+    }
+
+    // 创建并初始化（由服务端调用）；name 为空时使用匿名 memfd
+    void create(const std::string &name, uint32_t capacity) {
+        if (capacity < 2 || (capacity & (capacity - 1)) != 0) {
+            throw std::runtime_error("shmqueue: capacity must be a power of two");
+        }
+        fd = name.empty() ? memfd_create("sunshine-shmqueue", MFD_CLOEXEC)
+                          : shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) throw std::runtime_error("shmqueue: cannot create segment " + name);
+        size = bytes(capacity);
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) throw std::runtime_error("shmqueue: ftruncate failed");
+        map();
+        header *h = hdr();
+        h->magic = magic_word;
+        h->capacity = capacity;
+        new (&h->attached) std::atomic<uint32_t>(0);
+        shmRing::init(&h->req, req_cells(), capacity);
+        shmRing::init(&h->rsp, rsp_cells(), capacity);
+    }
+
+    // 打开已存在的段（由客户端调用）；fd 版本接管该描述符
+    void open(const std::string &name) {
+        int f = shm_open(name.c_str(), O_RDWR, 0);
+        if (f < 0) throw std::runtime_error("shmqueue: cannot open segment " + name);
+        open(f);
+    }
+
+    void open(int f) {
+        fd = f;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(header)) {
+            throw std::runtime_error("shmqueue: invalid segment");
+        }
+        size = static_cast<size_t>(st.st_size);
+        map();
+        if (hdr()->magic != magic_word || bytes(hdr()->capacity) != size) {
+            throw std::runtime_error("shmqueue: segment layout mismatch");
+        }
+    }
+
+    header *hdr() const {
+        return static_cast<header *>(base);
+    }
+
+    shmRing req() const {
+        return shmRing(&hdr()->req, req_cells(), hdr()->capacity);
+    }
+
+    shmRing rsp() const {
+        return shmRing(&hdr()->rsp, rsp_cells(), hdr()->capacity);
+    }
+
+    int handle() const {
+        return fd;
+    }
+
+private:
+    void map() {
+        base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            base = nullptr;
+            throw std::runtime_error("shmqueue: mmap failed");
+        }
+    }
+
+    shmCell *req_cells() const {
+        return reinterpret_cast<shmCell *>(static_cast<char *>(base) + sizeof(header));
+    }
+
+    shmCell *rsp_cells() const {
+        return req_cells() + hdr()->capacity;
+    }
+
+private:
+    int fd = -1;
+    void *base = nullptr;
+    size_t size = 0;
+};
+
+/**
+ * @brief 服务端：从共享内存请求队列取出任务描述符，交给本进程的 workbranch 执行并回写响应
+ *
+ * 析构时关闭请求队列，等待已取出的任务全部回写响应后关闭响应队列（客户端随后以连接关闭失败剩余请求）。
+ */
+class shmhost {
+public:
+    /**
+     * @param name shm_open 名称（如 "/myqueue"）；为空时创建匿名 memfd，通过 handle() 传给子进程
+     * @param capacity 每个方向的槽位数（2 的幂）
+     */
+    shmhost(const std::string &name, workbranch &wb, taskRegistry &reg, uint32_t capacity = 1024) :
+        m_name(name), m_branch(wb), m_registry(reg) {
+        m_seg.create(name, capacity);
+        m_req = m_seg.req();
+        m_rsp = m_seg.rsp();
+        m_dispatcher.reset(new autoThread<join>(std::thread(&shmhost::dispatch, this)));
+    }
+
+    shmhost(const shmhost &) = delete;
+    shmhost(shmhost &&) = delete;
+
+    ~shmhost() {
+        m_req.close();
+        m_dispatcher.reset(); // join
+        {
+            std::unique_lock<std::mutex> lock(m_lok);
+            m_idle.wait(lock, [this] { return m_inflight == 0; });
+        }
+        m_rsp.close();
+        if (!m_name.empty()) shm_unlink(m_name.c_str());
+    }
+
+    // 共享内存的文件描述符（memfd 模式下用于 fork 继承或 SCM_RIGHTS 传递）
+    int handle() const {
+        return m_seg.handle();
+    }
+
+private:
+    void dispatch() {
+        shmDesc req;
+        while (m_req.pop(req)) {
+            {
+                std::lock_guard<std::mutex> lock(m_lok);
+                ++m_inflight;
+            }
+            try {
+                // 被 abort 取消时同样回写（失败），保证每个已取出的请求都有响应、m_inflight 归零
+                m_branch.submit<cancel_aware>([this, req] {
+                    if (cancelling()) {
+                        reply(req.seq, false, "shmhost: cancelled by shutdown");
+                    } else {
+                        serve(req);
+                    }
+                });
+            } catch (const std::exception &ex) {
+                // 分支已关闭：直接回写失败
+                reply(req.seq, false, ex.what());
+            }
+        }
+    }
+
+    void serve(const shmDesc &req) {
+        std::string out;
+        bool ok = m_registry.invoke(req.type, req.payload, req.len, out);
+        if (out.size() > shmDesc::payload_size) {
+            ok = false;
+            out = "result exceeds shmqueue payload size";
+        }
+        reply(req.seq, ok, out);
+    }
+
+    void reply(uint64_t seq, bool ok, const std::string &out) {
+        shmDesc rsp;
+        rsp.seq = seq;
+        rsp.status = ok ? 0 : 1;
+        rsp.len = static_cast<uint32_t>(std::min(out.size(), shmDesc::payload_size));
+        std::memcpy(rsp.payload, out.data(), rsp.len);
+        m_rsp.push(rsp); // 客户端已断开时响应队列被关闭，push 直接失败
+        std::lock_guard<std::mutex> lock(m_lok);
+        if (--m_inflight == 0) m_idle.notify_all();
+    }
+
+private:
+    std::string m_name;
+    workbranch &m_branch;
+    taskRegistry &m_registry;
+    shmSegment m_seg;
+    shmRing m_req;
+    shmRing m_rsp;
+    std::mutex m_lok;
+    std::condition_variable m_idle;
+    size_t m_inflight = 0; // 已取出但尚未回写响应的请求数
+    std::unique_ptr<autoThread<join>> m_dispatcher;
+};
+
+/**
+ * @brief 客户端：把已注册类型的任务写入共享内存请求队列，由另一个进程的 shmhost 执行
+ *
+ * 参数编码后必须能放入一个描述符（shmDesc::payload_size 字节）。请求队列满时 submit 阻塞（背压）。
+ */
+class shmbranch : public remoteBranch {
+public:
+    explicit shmbranch(const std::string &name) {
+        m_seg.open(name);
+        attach();
+    }
+
+    // 使用继承或传递得到的 memfd（接管该描述符）
+    explicit shmbranch(int fd) {
+        m_seg.open(fd);
+        attach();
+    }
+
+    ~shmbranch() override {
+        m_rsp.close();
+        m_receiver.reset(); // join
+        fail_all("shmbranch: connection closed");
+    }
+
+protected:
+    void send(uint64_t seq, uint32_t type, const std::string &payload) override {
+        if (payload.size() > shmDesc::payload_size) {
+            throw std::runtime_error("shmbranch: arguments exceed shmqueue payload size");
+        }
+        shmDesc req;
+        req.seq = seq;
+        req.type = type;
+        req.len = static_cast<uint32_t>(payload.size());
+        std::memcpy(req.payload, payload.data(), payload.size());
+        if (!m_req.push(req)) throw std::runtime_error("shmbranch: host closed");
+    }
+
+private:
+    void attach() {
+        uint32_t expect = 0;
+        if (!m_seg.hdr()->attached.compare_exchange_strong(expect, 1)) {
+            throw std::runtime_error("shmbranch: segment already has a client");
+        }
+        m_req = m_seg.req();
+        m_rsp = m_seg.rsp();
+        m_receiver.reset(new autoThread<join>(std::thread(&shmbranch::receive, this)));
+    }
+
+    void receive() {
+        shmDesc rsp;
+        while (m_rsp.pop(rsp)) resolve(rsp.seq, rsp.status == 0, rsp.payload, rsp.len);
+        fail_all("shmbranch: connection closed");
+    }
+
+private:
+    shmSegment m_seg;
+    shmRing m_req;
+    shmRing m_rsp;
+    std::unique_ptr<autoThread<join>> m_receiver;
+};
+
+} // namespace details
+
+// 便捷别名
+using shmhost = details::shmhost;
+using shmbranch = details::shmbranch;
+
+} // namespace sunshine
+
+#endif // __linux__
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "libs/utility.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+
+namespace sunshine {
+namespace details {
+
+/**
+ * @brief 单飞（single-flight）去重：同一 key 同时只有一个计算在排队或运行
+ *
+ * 第一个提交者（leader）真正提交任务，其余提交者直接拿到 leader 的 shared_future。
+ * 可选的结果缓存：ttl > 0 时，成功完成的结果在 ttl 内继续被复用；失败的结果从不缓存。
+ *
+ * 内部按 key 的哈希分成 shard_count 个分片，每个分片一把锁，锁内只做一次哈希表查找/插入。
+ */
+class singleflight {
+public:
+    using clock = std::chrono::steady_clock;
+
+private:
+    struct entry {
+        std::type_index type = typeid(void); // 结果类型，防止同一 key 混用不同返回值
+        std::shared_ptr<void> fut;           // 指向 std::shared_future<R>
+        uint64_t id = 0;                     // 区分同一 key 的先后两次计算
+        bool landed = false;                 // 是否已完成（仅缓存模式下保留）
+        clock::time_point expire = {};       // 缓存到期时刻
+    };
+
+    struct alignas(64) shard {
+        std::mutex lok;
+        std::unordered_map<std::string, entry> map;
+        size_t sweep_at = 64; // 缓存条目超过该数时清理一次过期项（摊还）
+    };
+
+    static constexpr size_t shard_count = 16;
+
+public:
+    explicit singleflight(std::chrono::milliseconds ttl = std::chrono::milliseconds(0)) {
+        set_ttl(ttl);
+    }
+
+    singleflight(const singleflight &) = delete;
+    singleflight(singleflight &&) = delete;
+
+    /**
+     * @brief 设置结果缓存时长，0 表示完成即移除（只合并同时在途的请求）
+     */
+    void set_ttl(std::chrono::milliseconds ttl) {
+        m_ttl.store(std::chrono::duration_cast<clock::duration>(ttl).count(), std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 以 key 去重地执行 f
+     * @param launch 只在本次调用成为 leader 时被调用，参数是包装好的 void 任务，负责把它提交出去；
+     *               launch 抛出时条目被移除，已拿到 future 的调用者收到同一异常，异常随后重新抛给 leader
+     * @return 与同 key 的在途（或缓存中的）计算共享的 future
+     */
+    template <typename F, typename Launch, typename R = result_of_t<F>>
+    auto run(const std::string &key, F &&f, Launch &&launch) -> std::shared_future<R> {
+        shard &sd = m_shards[std::hash<std::string>{}(key) % shard_count];
+        auto task_promise = std::make_shared<std::promise<R>>();
+        std::shared_future<R> res;
+        uint64_t id;
+        {
+            std::lock_guard<std::mutex> lock(sd.lok);
+            auto it = sd.map.find(key);
+            if (it != sd.map.end() && it->second.landed && it->second.expire <= clock::now()) {
+                sd.map.erase(it); // 缓存已过期
+                it = sd.map.end();
+            }
+            if (it != sd.map.end()) {
+                if (it->second.type != std::type_index(typeid(R))) {
+                    throw std::logic_error("singleflight: key \"" + key + "\" reused with a different result type");
+                }
+                return *std::static_pointer_cast<std::shared_future<R>>(it->second.fut);
+            }
+            res = task_promise->get_future().share();
+            id = ++m_seq;
+            entry e;
+            e.type = typeid(R);
+            e.fut = std::make_shared<std::shared_future<R>>(res);
+            e.id = id;
+            sd.map.emplace(key, std::move(e));
+        }
+
+        // 在锁外提交，launch 即使同步执行任务也不会与 land() 争同一把分片锁
+        std::function<R()> exec = std::forward<F>(f);
+        try {
+            launch([this, key, id, exec = std::move(exec), task_promise]() {
+                bool ok = true;
+                try {
+                    fulfil(*task_promise, exec);
+                } catch (...) {
+                    ok = false;
+                    task_promise->set_exception(std::current_exception());
+                }
+                land(key, id, ok);
+            });
+        } catch (...) {
+            // 提交失败（如分支已关闭）：任务不会执行，把异常交给已在等待的调用者并移除条目，之后同 key 的调用重新提交
+            task_promise->set_exception(std::current_exception());
+            land(key, id, false);
+            throw;
+        }
+        return res;
+    }
+
+    /**
+     * @brief 当前登记的 key 数（在途 + 缓存）
+     */
+    size_t size() {
+        size_t n = 0;
+        for (auto &sd : m_shards) {
+            std::lock_guard<std::mutex> lock(sd.lok);
+            n += sd.map.size();
+        }
+        return n;
+    }
+
+private:
+    // 计算完成：不缓存（或失败）时移除条目，否则标记完成时刻
+    void land(const std::string &key, uint64_t id, bool ok) {
+        shard &sd = m_shards[std::hash<std::string>{}(key) % shard_count];
+        auto ttl = clock::duration(m_ttl.load(std::memory_order_relaxed));
+        std::lock_guard<std::mutex> lock(sd.lok);
+        auto it = sd.map.find(key);
+        if (it == sd.map.end() || it->second.id != id) return;
+        if (!ok || ttl.count() <= 0) {
+            sd.map.erase(it);
+            return;
+        }
+        auto now = clock::now();
+        it->second.landed = true;
+        it->second.expire = now + ttl;
+        if (sd.map.size() >= sd.sweep_at) {
+            for (auto cur = sd.map.begin(); cur != sd.map.end();) {
+                if (cur->second.landed && cur->second.expire <= now) {
+                    cur = sd.map.erase(cur);
+                } else {
+                    ++cur;
+                }
+            }
+            sd.sweep_at = std::max<size_t>(64, sd.map.size() * 2);
+        }
+    }
+
+private:
+    std::array<shard, shard_count> m_shards;
+    std::atomic<int64_t> m_ttl = {0};
+    std::atomic<uint64_t> m_seq = {0};
+};
+
+} // namespace details
+} // namespace sunshine
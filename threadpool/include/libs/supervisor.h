@@ -32,6 +32,10 @@ private:
     unsigned int m_tout = 0;   // 当前超时时间 (毫秒)
     const unsigned int m_tval; // 默认超时时间 (恢复用)
 
+    std::chrono::milliseconds m_stuckAfter{0}; // 看门狗阈值，0 表示关闭
+    bool m_compensate = false;                 // 是否为卡住的任务补充 worker
+    workbranch::stuckHandlerT m_onStuck;       // 卡住任务回调，转交给各分支
+
     std::mutex m_SupLock;             // 互斥锁
     std::condition_variable m_thrdCv; // 条件变量
 
@@ -78,9 +82,32 @@ public:
      */
     void add_super(workBranchPtr &b) {
         std::lock_guard<std::mutex> lock(m_SupLock);
+        if (m_stuckAfter.count() > 0) {
+            b->enable_watchdog(true);
+            b->set_stuck_handler(m_onStuck);
+        }
         m_branches.push_back(b);
     }
 
+    /**
+     * @brief 开启卡住任务看门狗（在监视线程的每个周期顺带扫描）
+     * @param stuckAfter 任务执行超过该时长即视为卡住，0 表示关闭
+     * @param compensate 为真时，每个卡住的任务允许分支额外增加一个 worker（可超出 wmax），
+     *        卡住的 worker 不计入扩容时的有效人手，任务恢复后多余 worker 按常规缩容
+     * @param onStuck 每个卡住的任务第一次被发现时在监视线程上回调一次（例如写日志），为空则只记录不通知
+     */
+    void set_watchdog(std::chrono::milliseconds stuckAfter, bool compensate = false,
+                      workbranch::stuckHandlerT onStuck = nullptr) {
+        std::lock_guard<std::mutex> lock(m_SupLock);
+        m_stuckAfter = stuckAfter;
+        m_compensate = compensate;
+        m_onStuck = std::move(onStuck);
+        for (auto &b : m_branches) {
+            b->enable_watchdog(stuckAfter.count() > 0);
+            b->set_stuck_handler(m_onStuck);
+        }
+    }
+
     /**
      * @brief 挂起监视器 (暂停工作)
      * @param t 暂停的时长，默认为最大无符号整数 (相当于无限长)
@@ -125,16 +152,21 @@ private:
                         size_t workNums = ptr->num_workers();
                         size_t taskNums = ptr->num_tasks();
 
+                        // 看门狗：卡住的 worker 在补偿模式下不计入有效人手，并相应抬高上限
+                        size_t stuckNums = m_stuckAfter.count() > 0 ? ptr->scan_stuck(m_stuckAfter) : 0;
+                        size_t extra = m_compensate ? stuckNums : 0;
+
                         // 策略：扩容 (Scale Up)
                         if (taskNums > 0) { // 如果有积压任务
-                            assert(workNums <= m_wmax);
+                            size_t limit = m_wmax + extra;
                             // 计算需要增加的人手：
-                            // 既不能超过最大工人数限制 (m_wmax - workNums)
-                            // 也不需要超过积压的任务数 (taskNums - workNums)
+                            // 既不能超过最大工人数限制 (m_wmax + extra - workNums)
+                            // 也不需要超过积压的任务数 (taskNums - 有效人手)
                             // 注意：这里需要防止无符号数减法溢出，通常 num_tasks() > num_workers() 才进这里
                             // 但为了安全，直接计算缺口
-                            size_t needed = (taskNums > workNums) ? (taskNums - workNums) : 0;
-                            size_t capacity = m_wmax - workNums;
+                            size_t effective = workNums > extra ? workNums - extra : 0;
+                            size_t needed = (taskNums > effective) ? (taskNums - effective) : 0;
+                            size_t capacity = limit > workNums ? limit - workNums : 0;
 
                             size_t nums_to_add = std::min(capacity, needed);
 
@@ -143,7 +175,7 @@ private:
                             }
                         }
                         // 策略：缩容 (Scale Down)
-                        else if (workNums > m_wmin) {
+                        else if (workNums > m_wmin + extra) {
                             ptr->del_worker(); // 慢速减少 (每次循环减一个)
                         }
                     }
@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <deque>
 #include <mutex>
 
@@ -10,40 +11,48 @@ public:
     void push_back(const T &v) {
         std::lock_guard<std::mutex> lock(tqLock);
         qu.push_back(v);
+        len.store(qu.size());
     }
 
     void push_back(T &&v) {
         std::lock_guard<std::mutex> lock(tqLock);
-        qu.push_back(move(v));
+        qu.push_back(std::move(v));
+        len.store(qu.size());
     }
 
     void push_front(const T &v) {
         std::lock_guard<std::mutex> lock(tqLock);
         qu.push_front(v);
+        len.store(qu.size());
     }
 
     void push_front(T &&v) {
         std::lock_guard<std::mutex> lock(tqLock);
-        qu.push_front(move(v));
+        qu.push_front(std::move(v));
+        len.store(qu.size());
     }
 
     bool try_pop(T &v) {
+        // 空队列不加锁；漏看刚入队的任务只会推迟到下一轮，挂起前的检查使用 getLength()
+        if (len.load(std::memory_order_relaxed) == 0) return false;
         std::lock_guard<std::mutex> lock(tqLock);
         if (!qu.empty()) {
             v = std::move(qu.front());
             qu.pop_front();
+            len.store(qu.size());
             return true;
         }
         return false;
     }
 
-    size_type getLength() {
-        std::lock_guard<std::mutex> lock(tqLock);
-        return qu.size();
+    // 队列长度（无锁读取）；与入队时的写入均为 seq_cst，提交方与挂起的 worker 不会互相错过
+    size_type getLength() const {
+        return len.load();
     }
 
 private:
     std::mutex tqLock;
     std::deque<T> qu;
+    std::atomic<size_type> len = {0}; // qu.size() 的无锁副本（在 tqLock 下写入）
 };
 } // namespace sunshine::details
\ No newline at end of file
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "libs/autothread.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sunshine {
+namespace details {
+
+/**
+ * @brief 单线程定时器：在指定时刻执行回调
+ *
+ * 回调在定时器线程上执行，应当短小（通常只是把真正的任务 submit 到某个 workbranch）。
+ * 析构时未到期的回调直接丢弃。
+ */
+class timer {
+public:
+    using clock = std::chrono::steady_clock;
+    using callbackT = std::function<void()>;
+
+private:
+    struct entry {
+        clock::time_point when;
+        uint64_t seq; // 同一时刻按加入顺序执行
+        callbackT cb;
+    };
+
+    // 小顶堆比较器：when 越早越靠前
+    struct later {
+        bool operator()(const entry &a, const entry &b) const noexcept {
+            return a.when != b.when ? a.when > b.when : a.seq > b.seq;
+        }
+    };
+
+    bool m_stopping = false;
+    uint64_t m_seq = 0;
+    std::vector<entry> m_heap;
+
+    std::mutex m_lok;
+    std::condition_variable m_cv;
+
+    // 注意：worker 放在最后，确保其他成员就绪后再启动线程
+    autoThread<join> m_worker;
+
+public:
+    timer() :
+        m_worker(std::thread(&timer::mission, this)) {
+    }
+
+    timer(const timer &) = delete;
+    timer(timer &&) = delete;
+
+    ~timer() {
+        {
+            std::lock_guard<std::mutex> lock(m_lok);
+            m_stopping = true;
+        }
+        m_cv.notify_one();
+        // m_worker 析构时 join
+    }
+
+public:
+    /**
+     * @brief 在 delay 之后执行 cb
+     */
+    void add(clock::duration delay, callbackT cb) {
+        add_at(clock::now() + delay, std::move(cb));
+    }
+
+    /**
+     * @brief 在时刻 when 执行 cb
+     */
+    void add_at(clock::time_point when, callbackT cb) {
+        bool earliest;
+        {
+            std::lock_guard<std::mutex> lock(m_lok);
+            m_heap.push_back({when, m_seq++, std::move(cb)});
+            std::push_heap(m_heap.begin(), m_heap.end(), later{});
+            earliest = m_heap.front().seq == m_seq - 1;
+        }
+        // 只有新回调成为最早到期者时才需要叫醒定时器线程重新计算等待时间
+        if (earliest) m_cv.notify_one();
+    }
+
+    /**
+     * @brief 尚未执行的回调数
+     */
+    size_t pending() {
+        std::lock_guard<std::mutex> lock(m_lok);
+        return m_heap.size();
+    }
+
+private:
+    void mission() {
+        std::unique_lock<std::mutex> lock(m_lok);
+        while (!m_stopping) {
+            if (m_heap.empty()) {
+                m_cv.wait(lock);
+                continue;
+            }
+            if (m_heap.front().when > clock::now()) {
+                m_cv.wait_until(lock, m_heap.front().when);
+                continue;
+            }
+            std::pop_heap(m_heap.begin(), m_heap.end(), later{});
+            callbackT cb = std::move(m_heap.back().cb);
+            m_heap.pop_back();
+
+            // 在锁外执行回调，回调内部可以继续 add
+            lock.unlock();
+            try {
+                cb();
+            } catch (const std::exception &ex) {
+                std::cerr << "timer: thread[" << std::this_thread::get_id()
+                          << "] caught exception:\n  what(): " << ex.what() << '\n'
+                          << std::flush;
+            } catch (...) {
+                std::cerr << "timer: thread[" << std::this_thread::get_id()
+                          << "] caught unknown exception\n"
+                          << std::flush;
+            }
+            lock.lock();
+        }
+    }
+};
+
+} // namespace details
+
+// 便捷别名
+using timer = details::timer;
+
+} // namespace sunshine
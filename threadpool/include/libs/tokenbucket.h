@@ -0,0 +1,107 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace sunshine {
+namespace details {
+
+/**
+ * @brief 无锁令牌桶：按 rate 个/秒产生令牌，最多积攒 burst 个
+ *
+ * 不需要后台线程补充令牌：状态只有一个原子时间戳 tat（令牌恰好被用尽的时刻），
+ * 取令牌时按单调时钟惰性计算当前令牌数 = (now + burst * T - max(tat, now)) / T（T = 1 / rate），
+ * 取走 n 个即把 tat 推后 n * T，整个过程是一次 CAS。rate <= 0 表示不限速。
+ * 运行中 configure 时，并发的请求可能仍按旧参数计算一次。
+ */
+class tokenBucket {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit tokenBucket(double rate = 0, double burst = 1) {
+        configure(rate, burst);
+    }
+
+    /**
+     * @brief 设置速率（个/秒）与突发容量（至少为 1）；rate <= 0 关闭限速
+     */
+    void configure(double rate, double burst = 1) {
+        int64_t t = rate > 0 ? std::max<int64_t>(static_cast<int64_t>(1e9 / rate), 1) : 0;
+        interval_ns.store(t, std::memory_order_relaxed);
+        window_ns.store(static_cast<int64_t>(static_cast<double>(t) * std::max(burst, 1.0)), std::memory_order_relaxed);
+    }
+
+    bool unlimited() const noexcept {
+        return interval_ns.load(std::memory_order_relaxed) == 0;
+    }
+
+    // 有 n 个令牌时取走并返回 true，否则不改变状态
+    bool try_acquire(size_t n = 1) noexcept {
+        int64_t t = interval_ns.load(std::memory_order_relaxed);
+        if (t == 0) return true;
+        int64_t now = now_ns();
+        int64_t cost = t * static_cast<int64_t>(n);
+        int64_t window = window_ns.load(std::memory_order_relaxed);
+        int64_t old = tat.load(std::memory_order_relaxed);
+        while (true) {
+            int64_t base = std::max(old, now);
+            if (base + cost - now > window) return false;
+            if (tat.compare_exchange_weak(old, base + cost, std::memory_order_relaxed)) return true;
+        }
+    }
+
+    /**
+     * @brief 无条件预订 n 个令牌（可透支），返回需要等待多久这些令牌才属于调用方
+     *
+     * 预订按调用顺序排队：透支越多，后来者等待越久，从而把超出速率的请求均匀地排到未来。
+     */
+    clock::duration reserve(size_t n = 1) noexcept {
+        int64_t t = interval_ns.load(std::memory_order_relaxed);
+        if (t == 0) return clock::duration::zero();
+        int64_t now = now_ns();
+        int64_t cost = t * static_cast<int64_t>(n);
+        int64_t window = window_ns.load(std::memory_order_relaxed);
+        int64_t old = tat.load(std::memory_order_relaxed);
+        while (!tat.compare_exchange_weak(old, std::max(old, now) + cost, std::memory_order_relaxed)) {
+        }
+        int64_t wait = std::max(old, now) + cost - now - window;
+        return std::chrono::duration_cast<clock::duration>(std::chrono::nanoseconds(std::max<int64_t>(wait, 0)));
+    }
+
+    // 归还 try_acquire 取走但未使用的令牌
+    void refund(size_t n = 1) noexcept {
+        tat.fetch_sub(interval_ns.load(std::memory_order_relaxed) * static_cast<int64_t>(n), std::memory_order_relaxed);
+    }
+
+    // 至少有一个令牌可取的时刻（现在已有令牌时返回不晚于 now 的时刻）
+    clock::time_point next_token() const noexcept {
+        int64_t t = interval_ns.load(std::memory_order_relaxed);
+        int64_t ready = tat.load(std::memory_order_relaxed) + t - window_ns.load(std::memory_order_relaxed);
+        return clock::time_point(std::chrono::duration_cast<clock::duration>(std::chrono::nanoseconds(ready)));
+    }
+
+    // 当前可用的令牌数（透支时为负）
+    double available() const noexcept {
+        int64_t t = interval_ns.load(std::memory_order_relaxed);
+        if (t == 0) return 0;
+        int64_t now = now_ns();
+        int64_t base = std::max(tat.load(std::memory_order_relaxed), now);
+        return static_cast<double>(now + window_ns.load(std::memory_order_relaxed) - base) / static_cast<double>(t);
+    }
+
+private:
+    static int64_t now_ns() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now().time_since_epoch()).count();
+    }
+
+private:
+    std::atomic<int64_t> tat = {0};         // 令牌恰好用尽的时刻（steady_clock 纳秒）
+    std::atomic<int64_t> interval_ns = {0}; // 产生一个令牌的间隔 T，0 表示不限速
+    std::atomic<int64_t> window_ns = {0};   // burst * T：tat 最多领先当前时刻这么多
+};
+
+} // namespace details
+} // namespace sunshine
@@ -0,0 +1,360 @@
+#pragma once
+
+// 基于 Unix 域套接字的进程外分支（POSIX）
+#if defined(__unix__) || defined(__APPLE__)
+
+#include "libs/autothread.h"
+#include "libs/remote.h"
+#include "libs/workbranch.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+namespace sunshine {
+namespace details {
+
+/**
+ * @brief 一条 Unix 域流式连接上的分帧收发
+ *
+ * 帧格式：len(4) type(4) seq(8) status(4) + len 字节 payload，主机字节序（只用于本机进程间）。
+ * 发送方只把帧追加到输出缓冲区，由独立的写线程一次 write 发出缓冲区中积累的所有帧：
+ * 写线程忙时到达的小消息自然合并成一批，请求可以连续发送而无需等待响应（流水线）。
+ * 接收方每次 read 尽量读满缓冲区，再从中切出所有完整的帧。
+ */
+class udsStream {
+public:
+    struct frame {
+        uint32_t len = 0;
+        uint32_t type = 0;
+        uint64_t seq = 0;
+        uint32_t status = 0;
+    };
+
+    static constexpr size_t header_size = 20;
+    static constexpr uint32_t max_payload = 64u << 20; // 单帧上限，防止对端数据损坏时分配过大内存
+
+    explicit udsStream(int fd) :
+        m_fd(fd) {
+        m_writer.reset(new autoThread<join>(std::thread(&udsStream::write_loop, this)));
+    }
+
+    udsStream(const udsStream &) = delete;
+    udsStream(udsStream &&) = delete;
+
+    ~udsStream() {
+        close();
+        m_writer.reset(); // join
+        ::close(m_fd);
+    }
+
+    // 追加一帧到输出缓冲区；连接已关闭时返回 false
+    bool send(const frame &f, const char *data) {
+        std::lock_guard<std::mutex> lock(m_lok);
+        if (m_closed) return false;
+        char hdr[header_size];
+        std::memcpy(hdr, &f.len, 4);
+        std::memcpy(hdr + 4, &f.type, 4);
+        std::memcpy(hdr + 8, &f.seq, 8);
+        std::memcpy(hdr + 16, &f.status, 4);
+        m_out.append(hdr, header_size);
+        m_out.append(data, f.len);
+        m_cv.notify_one();
+        return true;
+    }
+
+    /**
+     * @brief 阻塞读取直到连接关闭，每个完整帧调用一次 on_frame(const frame&, const char *payload)
+     */
+    template <typename OnFrame>
+    void read_loop(OnFrame &&on_frame) {
+        std::string in;
+        char buf[64 * 1024];
+        size_t off = 0;
+        while (true) {
+            ssize_t n = ::read(m_fd, buf, sizeof(buf));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            in.append(buf, static_cast<size_t>(n));
+            while (in.size() - off >= header_size) {
+                frame f;
+                std::memcpy(&f.len, in.data() + off, 4);
+                std::memcpy(&f.type, in.data() + off + 4, 4);
+                std::memcpy(&f.seq, in.data() + off + 8, 8);
+                std::memcpy(&f.status, in.data() + off + 16, 4);
+                if (f.len > max_payload) {
+                    close();
+                    return;
+                }
+                if (in.size() - off < header_size + f.len) break;
+                on_frame(f, in.data() + off + header_size);
+                off += header_size + f.len;
+            }
+            in.erase(0, off);
+            off = 0;
+        }
+        close();
+    }
+
+    // 关闭连接的两个方向：阻塞中的 read 返回 0，写线程发完已缓冲的数据后退出
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(m_lok);
+            if (m_closed) return;
+            m_closed = true;
+        }
+        m_cv.notify_one();
+        ::shutdown(m_fd, SHUT_RD);
+    }
+
+private:
+    void write_loop() {
+        std::string batch;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m_lok);
+                m_cv.wait(lock, [this] { return !m_out.empty() || m_closed; });
+                if (m_out.empty()) break; // 已关闭且无待发数据
+                batch.swap(m_out);
+            }
+            if (!write_all(batch)) {
+                std::lock_guard<std::mutex> lock(m_lok);
+                m_closed = true;
+                m_out.clear();
+                break;
+            }
+            batch.clear();
+        }
+        ::shutdown(m_fd, SHUT_WR);
+    }
+
+    bool write_all(const std::string &data) {
+        size_t done = 0;
+        while (done < data.size()) {
+#if defined(MSG_NOSIGNAL)
+            ssize_t n = ::send(m_fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+#else
+            ssize_t n = ::send(m_fd, data.data() + done, data.size() - done, 0);
+#endif
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            done += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+private:
+    int m_fd;
+    std::mutex m_lok;
+    std::condition_variable m_cv;
+    std::string m_out; // 待发送的帧（写线程整体取走）
+    bool m_closed = false;
+    std::unique_ptr<autoThread<join>> m_writer;
+};
+
+// 填充 Unix 域套接字地址；路径过长时抛出异常
+inline sockaddr_un uds_address(const std::string &path) {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) throw std::runtime_error("uds: socket path too long: " + path);
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+/**
+ * @brief 服务端（worker 守护进程）：在 path 上监听，把收到的请求交给本进程的 workbranch 执行并回写响应
+ *
+ * 每个连接一个读线程、一个写线程；同一连接上的请求并发执行，响应按完成顺序返回（客户端按 seq 匹配）。
+ * 析构时停止监听并关闭所有连接，等待已开始执行的请求结束。
+ */
+class udshost {
+public:
+    udshost(const std::string &path, workbranch &wb, taskRegistry &reg) :
+        m_path(path), m_branch(wb), m_registry(reg) {
+        m_listen = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (m_listen < 0) throw std::runtime_error("udshost: socket failed");
+        sockaddr_un addr = uds_address(path);
+        ::unlink(path.c_str());
+        if (::bind(m_listen, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || ::listen(m_listen, 64) != 0) {
+            ::close(m_listen);
+            throw std::runtime_error("udshost: cannot listen on " + path);
+        }
+        m_acceptor.reset(new autoThread<join>(std::thread(&udshost::accept_loop, this)));
+    }
+
+    udshost(const udshost &) = delete;
+    udshost(udshost &&) = delete;
+
+    ~udshost() {
+        m_stopping.store(true);
+        ::shutdown(m_listen, SHUT_RDWR); // 唤醒阻塞在 accept 上的线程
+        m_acceptor.reset();              // join
+        ::close(m_listen);
+        std::list<std::shared_ptr<session>> sessions;
+        {
+            std::lock_guard<std::mutex> lock(m_lok);
+            sessions.swap(m_sessions);
+        }
+        for (auto &s : sessions) s->stream.close();
+        for (auto &s : sessions) s->reader.reset(); // join
+        {
+            std::unique_lock<std::mutex> lock(m_lok);
+            m_idle.wait(lock, [this] { return m_inflight == 0; });
+        }
+        ::unlink(m_path.c_str());
+    }
+
+    // 当前连接数
+    size_t num_sessions() {
+        std::lock_guard<std::mutex> lock(m_lok);
+        return m_sessions.size();
+    }
+
+private:
+    struct session {
+        explicit session(int fd) :
+            stream(fd) {
+        }
+        udsStream stream;
+        std::weak_ptr<session> self; // 执行中的任务持有会话，保证连接断开后仍能安全回写
+        std::atomic<bool> done = {false};
+        std::unique_ptr<autoThread<join>> reader;
+    };
+
+    void accept_loop() {
+        while (!m_stopping.load()) {
+            int fd = ::accept(m_listen, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            auto s = std::make_shared<session>(fd);
+            s->self = s;
+            std::lock_guard<std::mutex> lock(m_lok);
+            // 顺带回收已断开的连接（其读线程已结束，join 不会阻塞）
+            m_sessions.remove_if([](const std::shared_ptr<session> &each) { return each->done.load(); });
+            s->reader.reset(new autoThread<join>(std::thread(&udshost::serve, this, s.get())));
+            m_sessions.push_back(std::move(s));
+        }
+    }
+
+    // 读线程：每个请求帧作为一个任务提交到分支
+    void serve(session *s) {
+        s->stream.read_loop([this, s](const udsStream::frame &f, const char *payload) {
+            {
+                std::lock_guard<std::mutex> lock(m_lok);
+                ++m_inflight;
+            }
+            auto self = s->self.lock();
+            std::string args(payload, f.len);
+            try {
+                // 被 abort 取消时同样回写（失败），保证客户端收到响应、m_inflight 归零
+                m_branch.submit<cancel_aware>([this, self, f, args = std::move(args)] {
+                    if (cancelling()) {
+                        reply(*self, f.seq, false, "udshost: cancelled by shutdown");
+                        return;
+                    }
+                    std::string out;
+                    bool ok = m_registry.invoke(f.type, args.data(), args.size(), out);
+                    reply(*self, f.seq, ok, out);
+                });
+            } catch (const std::exception &ex) {
+                reply(*self, f.seq, false, ex.what()); // 分支已关闭
+            }
+        });
+        s->done.store(true);
+    }
+
+    void reply(session &s, uint64_t seq, bool ok, const std::string &out) {
+        udsStream::frame f;
+        f.len = static_cast<uint32_t>(out.size());
+        f.seq = seq;
+        f.status = ok ? 0 : 1;
+        s.stream.send(f, out.data()); // 连接已断开时丢弃
+        std::lock_guard<std::mutex> lock(m_lok);
+        if (--m_inflight == 0) m_idle.notify_all();
+    }
+
+private:
+    std::string m_path;
+    workbranch &m_branch;
+    taskRegistry &m_registry;
+    int m_listen = -1;
+    std::atomic<bool> m_stopping = {false};
+    std::mutex m_lok;
+    std::condition_variable m_idle;
+    size_t m_inflight = 0; // 已提交但尚未回写响应的请求数
+    std::list<std::shared_ptr<session>> m_sessions;
+    std::unique_ptr<autoThread<join>> m_acceptor;
+};
+
+/**
+ * @brief 客户端：通过 Unix 域套接字把已注册类型的任务发给 udshost 所在进程执行
+ *
+ * 可 attach 到 workspace，与 shmbranch 一样通过 submit_remote 使用；参数大小不受描述符限制。
+ */
+class udsbranch : public remoteBranch {
+public:
+    explicit udsbranch(const std::string &path) {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) throw std::runtime_error("udsbranch: socket failed");
+        sockaddr_un addr = uds_address(path);
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+            ::close(fd);
+            throw std::runtime_error("udsbranch: cannot connect to " + path);
+        }
+        m_stream.reset(new udsStream(fd));
+        m_reader.reset(new autoThread<join>(std::thread(&udsbranch::receive, this)));
+    }
+
+    ~udsbranch() override {
+        m_stream->close();
+        m_reader.reset(); // join
+        m_stream.reset();
+        fail_all("udsbranch: connection closed");
+    }
+
+protected:
+    void send(uint64_t seq, uint32_t type, const std::string &payload) override {
+        if (payload.size() > udsStream::max_payload) throw std::runtime_error("udsbranch: arguments too large");
+        udsStream::frame f;
+        f.len = static_cast<uint32_t>(payload.size());
+        f.type = type;
+        f.seq = seq;
+        if (!m_stream->send(f, payload.data())) throw std::runtime_error("udsbranch: connection closed");
+    }
+
+private:
+    void receive() {
+        m_stream->read_loop([this](const udsStream::frame &f, const char *payload) {
+            resolve(f.seq, f.status == 0, payload, f.len);
+        });
+        fail_all("udsbranch: connection closed");
+    }
+
+private:
+    std::unique_ptr<udsStream> m_stream;
+    std::unique_ptr<autoThread<join>> m_reader;
+};
+
+} // namespace details
+
+// 便捷别名
+using udshost = details::udshost;
+using udsbranch = details::udsbranch;
+
+} // namespace sunshine
+
+#endif // __unix__ || __APPLE__
@@ -1,10 +1,12 @@
 #pragma once
+#include <atomic>
 #include <cstddef>
 #include <cstdlib>
 #include <deque>
 #include <functional>
 #include <future>
 #include <iterator>
+#include <stdexcept>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -35,9 +37,35 @@ using result_of_t = typename std::result_of<F(Args...)>::type;
 #endif
 
 // 任务类型标签 (用于函数重载和策略分发)
-struct normal {};   // 普通任务
-struct urgent {};   // 紧急任务
-struct sequence {}; // 串行任务
+struct normal {};         // 普通任务
+struct urgent {};         // 紧急任务
+struct fifo {};           // 普通任务，但总是排到全局队列尾部（不进入 LIFO next 槽）
+struct cancel_aware {};   // 排到全局队列尾部；被 abort 取消时仍会调用（cancelling() 为 true），由任务自行收尾
+struct sequence {};       // 串行任务
+struct inline_if_busy {}; // 分支饱和时由提交线程直接执行
+struct sheddable {};      // 低优先级任务，过载时可被准入控制拒绝
+struct background {};     // 后台任务，只在前台队列全空时执行
+
+// 分支类别标签：workspace::attach<cls> / submit<cls> 只在同类分支间路由；自定义类别从 branch_class 派生
+struct branch_class {};
+struct cpu_bound : branch_class {};        // 计算密集（如绑核的 worker）
+struct io_bound : branch_class {};         // 阻塞 I/O（大量可阻塞的 worker）
+struct latency_critical : branch_class {}; // 延迟敏感（自旋等待的 worker）
+
+template <typename T>
+struct is_branch_class : std::is_base_of<branch_class, T> {};
+
+// 任务被准入控制拒绝或削减时，其 future 以该异常失败
+class task_rejected : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// 分支以 abort 方式关闭时，尚未执行的任务的 future 以该异常失败
+class task_cancelled : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
 
 /**
  * @brief 自定义 function 实现，支持小对象优化 (Small Object Optimization, SOO)
@@ -267,6 +295,44 @@ private:
 // 线程池任务的标准类型
 using task = function_<void()>;
 
+// 当前线程正在执行的任务的 tag（由 tagged() 包装设置，worker 在每个任务开始前清空）
+// 使用原子量是为了让 supervisor 的看门狗能跨线程读取正在执行的任务 tag
+inline std::atomic<const char *> &current_task_tag() {
+    static thread_local std::atomic<const char *> tag = {nullptr};
+    return tag;
+}
+
+// 当前线程是否正在批量取消排队任务（workbranch::shutdown(abort) 设置，任务包装据此跳过执行）
+inline bool &cancelling() {
+    static thread_local bool flag = false;
+    return flag;
+}
+
+/**
+ * @brief 给任务打上 tag（用于 CPU 记账等按 tag 聚合的统计）
+ * @param tag 必须是生命周期覆盖任务执行及之后统计读取（CPU 记账按指针保存）的字符串，通常为字面量
+ * @return 可直接传给任意 submit 的可调用对象，返回值与 f 相同
+ */
+template <typename F>
+auto tagged(const char *tag, F &&f) {
+    return [tag, fn = std::decay_t<F>(std::forward<F>(f))]() mutable -> decltype(auto) {
+        current_task_tag().store(tag, std::memory_order_relaxed);
+        return fn();
+    };
+}
+
+// 执行 exec 并把结果写入 promise（统一 void 与非 void 返回值；异常由调用者处理）
+template <typename R, typename E>
+void fulfil(std::promise<R> &p, E &exec) {
+    p.set_value(exec());
+}
+
+template <typename E>
+void fulfil(std::promise<void> &p, E &exec) {
+    exec();
+    p.set_value();
+}
+
 /**
  * @brief std::future 结果的收集器
  * @tparam T future 的返回类型
@@ -2,21 +2,34 @@
 // workbranch.hpp
 // 修正版：按照模板实现的线程工作分支（包含详细中文注释）
 
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
 #include <cstdlib>
+#include <deque>
 #include <future>
 #include <functional>
 #include <iostream>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <type_traits>
 #include <utility>
+#include <vector>
 #include <chrono>
 #include <exception>
+#include <libs/admission.h>
 #include <libs/autothread.h>
+#include <libs/costmodel.h>
+#include <libs/cpuaccount.h>
+#include <libs/fairqueue.h>
+#include <libs/hashring.h>
+#include <libs/metrics.h>
+#include <libs/singleflight.h>
 #include <libs/taskqueue.h>
+#include <libs/tokenbucket.h>
 #include <libs/utility.h>
 
 namespace sunshine {
@@ -25,21 +38,135 @@ namespace sunshine {
 enum class waitStrategy {
     lowlatancy, // busy-wait + yield：最低延迟，CPU 占用高
     balance,    // 前一段 busy-wait，达到阈值后短暂 sleep：折中
-    blocking    // 使用条件变量阻塞，CPU 占用低但延迟较高
+    blocking,   // 使用条件变量阻塞，CPU 占用低但延迟较高
+    adaptive    // 按观测到的到达间隔与空闲比例自动调整自旋预算，预算耗尽后挂起
+};
+
+/// 关闭方式（workbranch::shutdown）
+enum class shutdownMode {
+    drain, // 拒绝新提交，执行完所有已排队任务后退出
+    abort  // 拒绝新提交，丢弃已排队任务（返回值任务的 future 以 task_cancelled 失败）
 };
 
 namespace details {
 
+/**
+ * @brief adaptive 策略下单个 worker 的负载观测器（仅由所属 worker 线程访问，无需同步）
+ *
+ * 每次空闲 -> 取到任务 记录一次等待时长（到达间隔），每次 忙碌 -> 空闲 记录一段忙碌时长，
+ * 两者都用 EWMA 平滑。自旋预算 = max_spin * (1 - 空闲比例) * min(1, spin_window / 平均等待)：
+ * 高峰期任务紧密到达时接近满额自旋，夜间稀疏到达时预算降为 0，直接挂起。
+ */
+class adaptiveSpin {
+public:
+    using clock = std::chrono::steady_clock;
+
+    explicit adaptiveSpin(int max_spin) :
+        max_spin(max_spin) {
+    }
+
+    // 从忙碌转为空闲时调用
+    void on_idle(clock::time_point now) {
+        idle = true;
+        busy_ns = static_cast<double>((now - mark).count());
+        mark = now;
+    }
+
+    // 从空闲转为忙碌（取到任务）时调用，重新计算自旋预算
+    void on_task(clock::time_point now) {
+        idle = false;
+        double wait_ns = static_cast<double>((now - mark).count());
+        mark = now;
+        gap_ns += alpha * (wait_ns - gap_ns);
+        double frac = wait_ns + busy_ns > 0 ? wait_ns / (wait_ns + busy_ns) : 1.0;
+        idle_frac += alpha * (frac - idle_frac);
+
+        double closeness = gap_ns <= spin_window_ns ? 1.0 : spin_window_ns / gap_ns;
+        spin_budget = static_cast<int>(max_spin * (1.0 - idle_frac) * closeness);
+    }
+
+    bool is_idle() const noexcept {
+        return idle;
+    }
+    int budget() const noexcept {
+        return spin_budget;
+    }
+
+private:
+    static constexpr double alpha = 0.2;             // EWMA 平滑系数
+    static constexpr double spin_window_ns = 50000.; // 平均等待短于 50us 时值得满额自旋
+
+    const int max_spin;
+    int spin_budget = 0;     // 初始不自旋，由观测结果逐步放开
+    bool idle = true;        // 当前是否处于空闲阶段
+    double gap_ns = 1e9;     // 空闲到取到任务的平均等待（EWMA）
+    double idle_frac = 1.0;  // 空闲时间占比（EWMA）
+    double busy_ns = 0;      // 最近一段忙碌时长
+    clock::time_point mark = clock::now();
+};
+
 // 任务类型（工作线程执行的基本单元）
 using task_t = std::function<void()>;
 
+// 分支对外发布的负载信号：独占一个缓存行，worker 每个任务两次改写 active 时不与分支的其他字段伪共享；
+// workspace 路由时以 relaxed 读取，不获取任何锁
+struct alignas(64) loadSignal {
+    std::atomic<size_t> active = {0};       // 正在执行任务的 worker 数
+    std::atomic<size_t> workers = {0};      // worker 数（workers.size() 的无锁副本）
+    std::atomic<uint64_t> service_ns = {0}; // 任务执行耗时的 EWMA（纳秒），0 表示尚无样本
+    std::atomic<uint64_t> work_ns = {0};    // submit_costed 提交、尚未执行完的任务的预估工作量之和（纳秒）
+    std::atomic<size_t> costed = {0};       // 上述任务的个数
+};
+
 // 注意：下面的 worker / taskqueue 类型名请与工程实际一致。
 // 假设 autothread<detach> 提供类型 member id，可以用作 map 的 key。
 class workbranch {
 public:
     using worker = autoThread<detach>;
     using worker_map = std::map<worker::id, worker>;
+    using tenant_t = fairQueue<task_t>::tenant_t;
+    using tenantStats = fairQueue<task_t>::tenantStats;
+
+    // 看门狗发现的卡住任务
+    struct stuckTask {
+        std::thread::id worker;                 // 执行该任务的 worker
+        const char *tag = nullptr;              // 任务 tag（未打 tag 时为 nullptr）
+        std::chrono::milliseconds elapsed = {}; // 已运行时长
+    };
+    using stuckHandlerT = std::function<void(const stuckTask &)>;
+
+private:
+    // broadcast 的汇合状态
+    struct broadcastState {
+        std::atomic<size_t> left = {0};     // 尚未执行完的 worker 数
+        std::atomic<bool> failed = {false}; // 是否已记录异常
+        std::exception_ptr error;           // 第一个异常
+        std::promise<void> done;
+    };
+
+    // worker 私有上下文：由 add_worker 创建并登记，归 mission() 所有，经 thread_local 指针暴露给同线程内的提交方
+    struct workerContext {
+        workbranch *owner = nullptr; // 所属分支，用于判断提交方是否为本分支 worker
+        task_t next = nullptr;       // LIFO next 槽：最近一次派生的后续任务
+        int lifo_streak = 0;         // 连续从 next 槽执行的次数
+        bool discarded = false;      // 当前任务被削减而未真正执行（不计入耗时统计）
+        bool fair_turn = false;      // 交替服务全局队列与租户队列，二者互不饿死
+        bool has_tenant = false;     // 当前任务是否来自租户队列
+        tenant_t tenant = 0;         // 当前任务所属租户（has_tenant 为真时有效）
+        std::deque<task_t> mailbox;  // 定向投递给该 worker 的任务（broadcast / submit_keyed，受 lok 保护）
+        std::atomic<size_t> mail = {0}; // mailbox 长度的无锁副本，worker 据此跳过加锁
+        uint64_t slot = 0;           // 在 submit_keyed 哈希环上的稳定编号（受 lok 保护）
+        bool sleeping = false;       // 是否挂起在 task_cv 上（受 lok 保护）
+        uint32_t sample_tick = 0;    // 负载信号的耗时采样计数
+
+        // 以下字段供 supervisor 看门狗跨线程读取
+        std::thread::id tid = {};                 // worker 线程 id
+        std::atomic<int64_t> task_start_ns = {0}; // 当前任务开始时刻（steady_clock），0 表示空闲
+        std::atomic<const char *> *tag = nullptr; // 指向 worker 线程的 current_task_tag()
+        int64_t flagged_start_ns = 0;             // 已告警过的任务开始时刻（避免重复告警，受 lok 保护）
+    };
 
+public:
     /**
      * @brief 构造函数：创建 wks 个 worker（至少 1 个），设置等待策略
      * @param wks 初始 worker 数量（最少 1）
@@ -63,14 +190,15 @@ public:
      * 实现思路：
      *  - 将 decline 设为当前 worker 数量（每个 worker 会处理一个退出请求）
      *  - 标记 destructing = true（用于唤醒阻塞策略下的线程）
-     *  - 对于 blocking 策略，notify_all 唤醒可能阻塞的线程
+     *  - 对于 blocking / adaptive 策略，notify_all 唤醒可能挂起的线程
      *  - 在 thread_cv 上等待 decline 被减为 0（表示所有退出请求已被处理）
      */
     ~workbranch() {
         std::unique_lock<std::mutex> lock(lok);
         decline = workers.size();
         destructing = true;
-        if (wait_strategy == waitStrategy::blocking) task_cv.notify_all();
+        if (may_park()) task_cv.notify_all();
+        token_cv.notify_all();
         // 等待直到 decline 被 worker 自行递减为 0
         thread_cv.wait(lock, [this] { return !decline; });
     }
@@ -82,8 +210,23 @@ public:
      */
     void add_worker() {
         std::lock_guard<std::mutex> lock(lok);
-        std::thread t(&workbranch::mission, this);
-        workers.emplace(t.get_id(), std::move(t)); // 将线程对象放入 map（key 为 id）
+        // 上下文在线程启动前登记（broadcast / submit_keyed / 看门狗立即可见），由 mission 接管并在退出时释放
+        std::unique_ptr<workerContext> ctx(new workerContext());
+        ctx->owner = this;
+        ctx->slot = next_slot++;
+        contexts.push_back(ctx.get());
+        keyed_ring.add(ctx.get(), ctx->slot);
+        try {
+            std::thread t(&workbranch::mission, this, ctx.get());
+            ctx->tid = t.get_id();
+            workers.emplace(t.get_id(), std::move(t)); // 将线程对象放入 map（key 为 id）
+        } catch (...) {
+            contexts.pop_back();
+            keyed_ring.remove(ctx.get(), ctx->slot);
+            throw;
+        }
+        ctx.release();
+        signal.workers.store(workers.size(), std::memory_order_relaxed);
     }
 
     /**
@@ -98,8 +241,9 @@ public:
         } else {
             // 请求减少一个 worker（由某个线程在安全点响应）
             decline++;
-            // 如果使用阻塞策略，唤醒一个阻塞的 worker 以便它能尽快看到 decline
-            if (wait_strategy == waitStrategy::blocking) task_cv.notify_one();
+            // 如果 worker 可能挂起，唤醒一个以便它能尽快看到 decline
+            if (may_park()) task_cv.notify_one();
+            token_cv.notify_all();
         }
     }
 
@@ -108,34 +252,16 @@ public:
      * @param timeout 毫秒，默认 unsigned(-1) 表示无限等待
      * @return true 如果在 timeout 内完成等待（否则 false）
      *
-     * 协议（两阶段）：
-     *  1) is_waiting = true；唤醒阻塞 worker（如果是 blocking 策略）；
-     *     等待 task_done_workers >= workers.size()，表示所有 worker 都已报告自己空闲
-     *  2) is_waiting = false；thread_cv.notify_all() 恢复 worker；
-     *     再等待所有 worker 报告已从等待恢复（waiting_finished_worker >= workers.size()）
+     * 协议：
+     *  1) is_waiting = true；唤醒挂起的 worker（blocking / adaptive 策略）；
+     *     等待 task_done_workers >= workers.size()（或超时），表示所有 worker 都已报告自己空闲
+     *  2) is_waiting = false 并推进 wait_round；thread_cv.notify_all() 恢复 worker。
+     *     worker 等待的是 wait_round 变化，恢复时不再需要回报，超时时也不必等待未进入握手的 worker
      */
     bool wait_tasks(unsigned timeout = static_cast<unsigned>(-1)) {
-        bool res;
-        {
-            std::unique_lock<std::mutex> locker(lok);
-            m_is_waiting = true; // worker 将上报空闲
-            if (wait_strategy == waitStrategy::blocking) task_cv.notify_all();
-            // 等待所有 worker 报告空闲（或超时）
-            res = task_done_cv.wait_for(locker, std::chrono::milliseconds(timeout), [this] {
-                return task_done_workers >= workers.size();
-            });
-            // 清理计数并关闭等待标志（先关闭再发 recover 信号）
-            task_done_workers = 0;
-            m_is_waiting = false;
-        }
-        // 告知所有 worker 恢复
-        thread_cv.notify_all();
-
-        // 再等待所有 worker 报告已从等待中恢复
-        std::unique_lock<std::mutex> locker(lok);
-        waiting_finished.wait(locker, [this] { return waiting_finished_worker >= workers.size(); });
-        waiting_finished_worker = 0;
-        return res;
+        using namespace std::chrono;
+        if (timeout == static_cast<unsigned>(-1)) return wait_idle(steady_clock::time_point::max());
+        return wait_idle(steady_clock::now() + milliseconds(timeout));
     }
 
     /**
@@ -147,10 +273,243 @@ public:
     }
 
     /**
-     * @brief 返回任务队列中的任务数（依赖 taskqueue::length() 线程安全）
+     * @brief 返回当前未在执行任务的 worker 数（无锁近似值）
+     */
+    size_t num_idle() const {
+        size_t n = signal.workers.load(std::memory_order_relaxed);
+        size_t a = signal.active.load(std::memory_order_relaxed);
+        return n > a ? n - a : 0;
+    }
+
+    /**
+     * @brief 负载信号（worker 数、忙碌 worker 数、执行耗时 EWMA），可无锁读取
+     */
+    const loadSignal &load_signal() const {
+        return signal;
+    }
+
+    /**
+     * @brief 新任务的预期完成时延（纳秒，无锁近似值）：(未完成工作量 + 平均执行耗时) / worker 数
+     *
+     * 未完成工作量 = submit_costed 任务的预估耗时之和 + 其余排队/执行中任务数 × 平均执行耗时。
+     * 用于 join-shortest-expected-delay 路由；尚无耗时样本时平均耗时以 1 代替，退化为按 worker 数归一化的任务数。
+     */
+    double expected_delay() const {
+        size_t w = signal.workers.load(std::memory_order_relaxed);
+        size_t a = signal.active.load(std::memory_order_relaxed);
+        uint64_t svc = signal.service_ns.load(std::memory_order_relaxed);
+        size_t q = tq.getLength() + fq.getLength() + mailed.load(std::memory_order_relaxed);
+        size_t c = signal.costed.load(std::memory_order_relaxed);
+        double work = static_cast<double>(signal.work_ns.load(std::memory_order_relaxed));
+        double mean = static_cast<double>(svc ? svc : 1);
+        double others = q + a > c ? static_cast<double>(q + a - c) : 0.;
+        return (work + (others + 1) * mean) / static_cast<double>(w ? w : 1);
+    }
+
+    /**
+     * @brief 开关任务耗时统计（默认关闭）；开启后每个任务多两次时钟读取（开启准入控制时也会统计）
+     */
+    void enable_timing(bool on) {
+        timing_enabled.store(on, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 返回已统计任务执行耗时的 p 分位（0 < p <= 1）；未开启统计或无样本时返回 0
+     */
+    std::chrono::nanoseconds service_time(double p) const {
+        return svc_hist.percentile(p);
+    }
+
+    /**
+     * @brief 开关准入控制（默认关闭），只作用于 submit<sheddable> 提交的任务
+     * @param target CoDel target：排队时长持续高于该值视为可能存在常驻队列
+     * @param interval CoDel interval：排队时长在整个 interval 内都高于 target 才判定为常驻队列
+     *
+     * 开启后：提交时按 队列深度 * 平均执行耗时 / worker 数 预测排队时间，超过任务 SLO 即拒绝；
+     * 存在常驻队列时，出队时已超出自身 SLO 的任务直接失败。开启后每个任务多两次时钟读取。
+     */
+    void enable_admission(bool on, std::chrono::microseconds target = std::chrono::microseconds(5000),
+                          std::chrono::microseconds interval = std::chrono::microseconds(100000)) {
+        admission.configure(target, interval);
+        admission_enabled.store(on, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 被准入控制拒绝或削减的任务数
+     */
+    uint64_t num_rejected() const {
+        return admission.num_rejected();
+    }
+
+    /**
+     * @brief 开关任务 CPU 时间记账（默认关闭）
+     *
+     * 开启后 worker 在每个任务前后读取线程 CPU 时钟，按任务 tag（见 tagged()）和租户
+     * （submit_tenant 提交的任务）汇总。
+     */
+    void enable_cpu_accounting(bool on) {
+        cpu_enabled.store(on, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 返回某个 tag 的累计任务数与 CPU 时间
+     */
+    cpuUsage tag_cpu(const std::string &tag) {
+        return cpu_acct.tag_usage(tag);
+    }
+
+    /**
+     * @brief 返回某个租户的累计任务数与 CPU 时间
+     */
+    cpuUsage tenant_cpu(tenant_t tenant) {
+        return cpu_acct.tenant_usage(tenant);
+    }
+
+    /**
+     * @brief 设置租户 CPU 配额（同时开启 CPU 记账）
+     * @param cores 允许占用的核数，<= 0 表示取消配额
+     * @param window 滑动窗口长度
+     *
+     * 超额租户的任务被降级：只有其他租户都没有可执行任务时才会被调度。
+     */
+    void set_tenant_cpu_quota(tenant_t tenant, double cores,
+                              std::chrono::milliseconds window = std::chrono::milliseconds(1000)) {
+        cpu_acct.set_quota(tenant, cores, window);
+        if (cores > 0) enable_cpu_accounting(true);
+    }
+
+    /**
+     * @brief 开关卡住任务检测所需的任务开始时间戳（由 supervisor::set_watchdog 调用，也可手动开启）
+     */
+    void enable_watchdog(bool on) {
+        watch_enabled.store(on, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 设置卡住任务的回调：每个卡住的任务只在第一次被发现时回调一次（空函数表示不通知）
+     *
+     * 回调在 scan_stuck 的调用线程（通常是 supervisor 的监视线程）上执行，此时不持有分支内部的锁。
+     */
+    void set_stuck_handler(stuckHandlerT handler) {
+        std::lock_guard<std::mutex> lock(lok);
+        stuck_handler = std::move(handler);
+    }
+
+    /**
+     * @brief 扫描所有 worker，找出执行时间超过 threshold 的任务
+     * @return 当前卡住的任务数；结果同时保存为 stuck_tasks() / num_stuck() 的快照
+     *
+     * 新发现的卡住任务交给 set_stuck_handler 设置的回调（在释放锁之后调用）。
+     */
+    size_t scan_stuck(std::chrono::milliseconds threshold) {
+        auto now = std::chrono::steady_clock::now().time_since_epoch().count();
+        auto limit = std::chrono::duration_cast<std::chrono::steady_clock::duration>(threshold).count();
+        std::vector<stuckTask> found, fresh;
+        stuckHandlerT handler;
+        size_t count = 0;
+        {
+            std::lock_guard<std::mutex> lock(lok);
+            for (workerContext *c : contexts) {
+                int64_t started = c->task_start_ns.load(std::memory_order_relaxed);
+                if (started == 0 || now - started < limit) continue;
+                stuckTask st;
+                st.worker = c->tid;
+                st.tag = c->tag ? c->tag->load(std::memory_order_relaxed) : nullptr;
+                st.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::duration(now - started));
+                if (c->flagged_start_ns != started) {
+                    c->flagged_start_ns = started;
+                    fresh.push_back(st);
+                }
+                found.push_back(st);
+            }
+            stuck.swap(found);
+            count = stuck.size();
+            nstuck.store(count, std::memory_order_relaxed);
+            if (!fresh.empty()) handler = stuck_handler;
+        }
+        if (handler) {
+            for (const stuckTask &st : fresh) handler(st);
+        }
+        return count;
+    }
+
+    /**
+     * @brief 最近一次 scan_stuck 发现的卡住任务数
+     */
+    size_t num_stuck() const {
+        return nstuck.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 最近一次 scan_stuck 发现的卡住任务（worker 线程 id、tag、已运行时长）
+     */
+    std::vector<stuckTask> stuck_tasks() {
+        std::lock_guard<std::mutex> lock(lok);
+        return stuck;
+    }
+
+    /**
+     * @brief 开关 LIFO next 槽（默认关闭）
+     *
+     * 开启时，本分支 worker 在任务内提交的普通 void 任务不进入全局队列，而是放进该 worker 的
+     * next 槽，在当前任务结束后立刻执行（缓存仍热、无排队延迟）。连续从槽位执行 max_lifo_streak
+     * 次后，槽内任务会让位到全局队列尾部，防止互相投递的任务链饿死队列中的其他任务。
+     * 注意：槽内任务只能由本 worker 执行，其他空闲 worker 不会取走它；任务提交后继续阻塞等待该后续任务
+     * 会自锁，因此默认关闭，只应在确认没有这种用法的分支上开启。
+     * 返回值任务（返回 future）始终走全局队列，避免在任务内 get() 造成自锁。
+     */
+    void enable_lifo(bool on) {
+        lifo_enabled.store(on, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 设置 inline_if_busy 的积压阈值：所有 worker 都在执行任务且队列长度超过该值时，
+     *        submit<inline_if_busy> 在提交线程上同步执行（默认 0，即有任何积压即内联）
+     */
+    void set_inline_threshold(size_t n) {
+        inline_threshold.store(n, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 限制分支开始执行任务的速率（个/秒），突发最多 burst 个；rate <= 0 取消限速
+     *
+     * 作用于本分支的所有任务（含 mailbox 中的定向任务）：worker 取任务前先从无锁令牌桶取令牌，
+     * 没有令牌时任务留在队列中，空闲 worker 睡到下一个令牌产生，而不是在任务内 sleep 占用 worker。
+     * 排队的任务仍计入 num_tasks()；wait_tasks / shutdown(drain) 会按该速率等到队列排空。
+     */
+    void set_rate_limit(double rate, double burst = 1) {
+        bucket.configure(rate, burst);
+        rate_limited.store(!bucket.unlimited(), std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(lok);
+        token_cv.notify_all();
+    }
+
+    /**
+     * @brief 返回排队中的任务数：全局队列、租户队列与各 worker mailbox 中的定向任务（依赖 taskqueue::length() 线程安全）
      */
     size_t num_tasks() {
-        return tq.getLength();
+        return tq.getLength() + fq.getLength() + mailed.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 返回后台任务队列中的任务数（不计入 num_tasks()，因此不会触发 supervisor 扩容）
+     */
+    size_t num_background() {
+        return bq.getLength();
+    }
+
+    /**
+     * @brief 设置租户份额（加权公平调度的权重，至少为 1；未设置的租户为 1）
+     */
+    void set_tenant_share(tenant_t tenant, uint32_t weight) {
+        fq.set_weight(tenant, weight);
+    }
+
+    /**
+     * @brief 返回租户的排队深度、累计入队/出队数与份额
+     */
+    tenantStats tenant_stats(tenant_t tenant) {
+        return fq.stats(tenant);
     }
 
 public:
@@ -158,68 +517,60 @@ public:
     template <typename T = normal, typename F, typename R = result_of_t<F>,
               typename DR = typename std::enable_if<std::is_void<R>::value>::type>
     auto submit(F &&task) -> typename std::enable_if<std::is_same<T, normal>::value>::type {
-        // 把可调用对象包装为 std::function<void()>
-        std::function<void()> fn = std::forward<F>(task);
-        tq.push_back([fn]() mutable {
-            try {
-                fn();
-            } catch (const std::exception &ex) {
-                std::cerr << "workbranch: worker[" << std::this_thread::get_id()
-                          << "] caught exception:\n  what(): " << ex.what() << '\n'
-                          << std::flush;
-            } catch (...) {
-                std::cerr << "workbranch: worker[" << std::this_thread::get_id()
-                          << "] caught unknown exception\n"
-                          << std::flush;
+        ensure_open();
+        task_t wrapped = wrap_void(std::forward<F>(task));
+        // 由本分支 worker 在任务内提交的后续任务放入该 worker 的 next 槽，紧接着当前任务执行
+        workerContext *ctx = local_worker();
+        if (ctx && ctx->owner == this && lifo_enabled.load(std::memory_order_relaxed)) {
+            if (ctx->next) {
+                // 槽位已被占用：旧任务让位到全局队列尾部（与 Go runnext 一致）
+                tq.push_back(std::move(ctx->next));
+                notify_worker();
             }
-        });
-        if (wait_strategy == waitStrategy::blocking) task_cv.notify_one();
+            ctx->next = std::move(wrapped);
+            return;
+        }
+        tq.push_back(std::move(wrapped));
+        notify_worker();
     }
 
     // ------------------ submit（紧急 void 任务，插队执行） ------------------
     template <typename T, typename F, typename R = result_of_t<F>,
               typename DR = typename std::enable_if<std::is_void<R>::value>::type>
     auto submit(F &&task) -> typename std::enable_if<std::is_same<T, urgent>::value>::type {
-        std::function<void()> fn = std::forward<F>(task);
-        tq.push_front([fn]() mutable {
-            try {
-                fn();
-            } catch (const std::exception &ex) {
-                std::cerr << "workbranch: worker[" << std::this_thread::get_id()
-                          << "] caught exception:\n  what(): " << ex.what() << '\n'
-                          << std::flush;
-            } catch (...) {
-                std::cerr << "workbranch: worker[" << std::this_thread::get_id()
-                          << "] caught unknown exception\n"
-                          << std::flush;
-            }
-        });
-        if (wait_strategy == waitStrategy::blocking) task_cv.notify_one();
+        ensure_open();
+        tq.push_front(wrap_void(std::forward<F>(task)));
+        notify_worker();
+    }
+
+    // ------------------ submit（fifo：即使在本分支 worker 内提交也排到全局队列尾部） ------------------
+    template <typename T, typename F, typename R = result_of_t<F>,
+              typename DR = typename std::enable_if<std::is_void<R>::value>::type>
+    auto submit(F &&task) -> typename std::enable_if<std::is_same<T, fifo>::value>::type {
+        ensure_open();
+        tq.push_back(wrap_void(std::forward<F>(task)));
+        notify_worker();
+    }
+
+    // ------------------ submit（cancel_aware：被 abort 取消时仍调用一次，任务据 cancelling() 回复或释放资源） ------------------
+    template <typename T, typename F, typename R = result_of_t<F>,
+              typename DR = typename std::enable_if<std::is_void<R>::value>::type>
+    auto submit(F &&task) -> typename std::enable_if<std::is_same<T, cancel_aware>::value>::type {
+        ensure_open();
+        tq.push_back(wrap_aware(std::forward<F>(task)));
+        notify_worker();
     }
 
     // ------------------ submit（sequence：把多个可调用对象合并成一个任务按序执行） ------------------
     template <typename T, typename F, typename... Fs>
     auto submit(F &&task, Fs &&...tasks) -> typename std::enable_if<std::is_same<T, sequence>::value>::type {
+        ensure_open();
         // 用值捕获保证闭包中对象的生命周期
         auto bound = std::make_shared<std::tuple<std::decay_t<F>, std::decay_t<Fs>...>>(
             std::forward<F>(task), std::forward<Fs>(tasks)...);
-        tq.push_back([bound, this]() {
-            try {
-                // 通过 rexec 展开并按序执行。这里直接使用捕获的 tuple 里存的函数对象。
-                // 为简单起见，使用 lambda 调用 rexec（rexec 本身使用模板展开）
-                // 我们需要将 tuple 中元素展开为参数 —— 这里用 helper
-                apply_sequence_and_rexec(*bound);
-            } catch (const std::exception &ex) {
-                std::cerr << "workbranch: worker[" << std::this_thread::get_id()
-                          << "] caught exception:\n  what(): " << ex.what() << '\n'
-                          << std::flush;
-            } catch (...) {
-                std::cerr << "workbranch: worker[" << std::this_thread::get_id()
-                          << "] caught unknown exception\n"
-                          << std::flush;
-            }
-        });
-        if (wait_strategy == waitStrategy::blocking) task_cv.notify_one();
+        // 通过 rexec 展开 tuple 并按序执行
+        tq.push_back(wrap_void([bound, this]() { apply_sequence_and_rexec(*bound); }));
+        notify_worker();
     }
 
     // ------------------ submit（普通返回值任务，返回 future） ------------------
@@ -227,27 +578,11 @@ public:
               typename DR = typename std::enable_if<!std::is_void<R>::value, R>::type>
     auto submit(F &&task, typename std::enable_if<std::is_same<T, normal>::value, normal>::type = {})
         -> std::future<R> {
-        // 使用 std::function<R()> 包装可调用对象并用 shared_ptr 管理 promise 保证生命周期
-        std::function<R()> exec = std::forward<F>(task);
+        ensure_open();
+        // 用 shared_ptr 管理 promise 保证生命周期
         auto task_promise = std::make_shared<std::promise<R>>();
-        tq.push_back([exec = std::move(exec), task_promise]() {
-            try {
-                task_promise->set_value(exec());
-            } catch (...) {
-                try {
-                    task_promise->set_exception(std::current_exception());
-                } catch (const std::exception &ex) {
-                    std::cerr << "workbranch: worker[" << std::this_thread::get_id()
-                              << "] caught exception while setting promise:\n  what(): " << ex.what() << '\n'
-                              << std::flush;
-                } catch (...) {
-                    std::cerr << "workbranch: worker[" << std::this_thread::get_id()
-                              << "] caught unknown exception while setting promise\n"
-                              << std::flush;
-                }
-            }
-        });
-        if (wait_strategy == waitStrategy::blocking) task_cv.notify_one();
+        tq.push_back(wrap_value<R>(std::forward<F>(task), task_promise));
+        notify_worker();
         return task_promise->get_future();
     }
 
@@ -256,27 +591,296 @@ public:
               typename DR = typename std::enable_if<!std::is_void<R>::value, R>::type>
     auto submit(F &&task, typename std::enable_if<std::is_same<T, urgent>::value, urgent>::type = {})
         -> std::future<R> {
-        std::function<R()> exec = std::forward<F>(task);
+        ensure_open();
         auto task_promise = std::make_shared<std::promise<R>>();
-        tq.push_front([exec = std::move(exec), task_promise]() {
-            try {
-                task_promise->set_value(exec());
-            } catch (...) {
+        tq.push_front(wrap_value<R>(std::forward<F>(task), task_promise));
+        notify_worker();
+        return task_promise->get_future();
+    }
+
+    // ------------------ submit（inline_if_busy：分支饱和时在提交线程上直接执行） ------------------
+    template <typename T, typename F, typename R = result_of_t<F>,
+              typename DR = typename std::enable_if<std::is_void<R>::value>::type>
+    auto submit(F &&task) -> typename std::enable_if<std::is_same<T, inline_if_busy>::value>::type {
+        ensure_open();
+        if (!saturated()) {
+            submit<normal>(std::forward<F>(task));
+            return;
+        }
+        // 所有 worker 都在忙且积压超过阈值：由提交方执行，既省去排队开销也形成天然背压
+        try {
+            task();
+        } catch (const std::exception &ex) {
+            std::cerr << "workbranch: submitter[" << std::this_thread::get_id()
+                      << "] caught exception:\n  what(): " << ex.what() << '\n'
+                      << std::flush;
+        } catch (...) {
+            std::cerr << "workbranch: submitter[" << std::this_thread::get_id()
+                      << "] caught unknown exception\n"
+                      << std::flush;
+        }
+    }
+
+    template <typename T, typename F, typename R = result_of_t<F>,
+              typename DR = typename std::enable_if<!std::is_void<R>::value, R>::type>
+    auto submit(F &&task, typename std::enable_if<std::is_same<T, inline_if_busy>::value, inline_if_busy>::type = {})
+        -> std::future<R> {
+        ensure_open();
+        if (!saturated()) return submit<normal>(std::forward<F>(task));
+        // 同步执行并返回一个已就绪的 future
+        std::promise<R> task_promise;
+        try {
+            task_promise.set_value(task());
+        } catch (...) {
+            task_promise.set_exception(std::current_exception());
+        }
+        return task_promise.get_future();
+    }
+
+    // ------------------ submit（sheddable：受准入控制的可削减任务，返回是否被接受） ------------------
+    template <typename T, typename F, typename R = result_of_t<F>,
+              typename DR = typename std::enable_if<std::is_void<R>::value>::type>
+    auto submit(F &&task, std::chrono::microseconds slo)
+        -> typename std::enable_if<std::is_same<T, sheddable>::value, bool>::type {
+        ensure_open();
+        if (!admit(slo)) return false;
+        auto enqueued = std::chrono::steady_clock::now();
+        tq.push_back(wrap_void([this, fn = std::decay_t<F>(std::forward<F>(task)), slo, enqueued]() mutable {
+            if (!shed_on_dequeue(enqueued, slo)) fn();
+        }));
+        notify_worker();
+        return true;
+    }
+
+    // ------------------ submit（sheddable 返回值任务：被拒绝时 future 立即以 task_rejected 失败） ------------------
+    template <typename T, typename F, typename R = result_of_t<F>,
+              typename DR = typename std::enable_if<!std::is_void<R>::value, R>::type>
+    auto submit(F &&task, std::chrono::microseconds slo,
+                typename std::enable_if<std::is_same<T, sheddable>::value, sheddable>::type = {}) -> std::future<R> {
+        ensure_open();
+        auto task_promise = std::make_shared<std::promise<R>>();
+        if (!admit(slo)) {
+            task_promise->set_exception(std::make_exception_ptr(task_rejected("workbranch: predicted queueing delay exceeds SLO")));
+            return task_promise->get_future();
+        }
+        auto enqueued = std::chrono::steady_clock::now();
+        // 出队时被削减则抛出 task_rejected，由 wrap_value 写入 future
+        tq.push_back(wrap_value<R>([this, exec = std::decay_t<F>(std::forward<F>(task)), slo, enqueued]() mutable -> R {
+            if (shed_on_dequeue(enqueued, slo)) throw task_rejected("workbranch: shed from standing queue");
+            return exec();
+        }, task_promise));
+        notify_worker();
+        return task_promise->get_future();
+    }
+
+    // ------------------ submit（background：仅在前台队列全空时执行的后台 void 任务） ------------------
+    template <typename T, typename F, typename R = result_of_t<F>,
+              typename DR = typename std::enable_if<std::is_void<R>::value>::type>
+    auto submit(F &&task) -> typename std::enable_if<std::is_same<T, background>::value>::type {
+        ensure_open();
+        bq.push_back(wrap_void(std::forward<F>(task)));
+        notify_worker();
+    }
+
+    // ------------------ submit（background 返回值任务） ------------------
+    template <typename T, typename F, typename R = result_of_t<F>,
+              typename DR = typename std::enable_if<!std::is_void<R>::value, R>::type>
+    auto submit(F &&task, typename std::enable_if<std::is_same<T, background>::value, background>::type = {})
+        -> std::future<R> {
+        ensure_open();
+        auto task_promise = std::make_shared<std::promise<R>>();
+        bq.push_back(wrap_value<R>(std::forward<F>(task), task_promise));
+        notify_worker();
+        return task_promise->get_future();
+    }
+
+    // ------------------ submit_tenant（按租户加权公平调度的 void 任务） ------------------
+    template <typename F, typename R = result_of_t<F>,
+              typename DR = typename std::enable_if<std::is_void<R>::value>::type>
+    void submit_tenant(tenant_t tenant, F &&task) {
+        ensure_open();
+        fq.push_back(tenant, wrap_void(std::forward<F>(task)));
+        notify_worker();
+    }
+
+    // ------------------ submit_tenant（按租户加权公平调度的返回值任务） ------------------
+    template <typename F, typename R = result_of_t<F>,
+              typename DR = typename std::enable_if<!std::is_void<R>::value, R>::type>
+    auto submit_tenant(tenant_t tenant, F &&task) -> std::future<R> {
+        ensure_open();
+        auto task_promise = std::make_shared<std::promise<R>>();
+        fq.push_back(tenant, wrap_value<R>(std::forward<F>(task), task_promise));
+        notify_worker();
+        return task_promise->get_future();
+    }
+
+    // ------------------ submit_once（按 key 去重：同 key 在排队/运行中时复用同一个 future） ------------------
+    template <typename F, typename R = result_of_t<F>>
+    auto submit_once(const std::string &key, F &&task) -> std::shared_future<R> {
+        ensure_open();
+        // 被 abort 取消时抛出 task_cancelled，由 singleflight 写入共享 future 并移除该 key
+        auto exec = [fn = std::decay_t<F>(std::forward<F>(task))]() mutable -> R {
+            if (cancelling()) throw task_cancelled("workbranch: cancelled by shutdown");
+            return fn();
+        };
+        return flights.run(key, std::move(exec), [this](task_t &&t) {
+            tq.push_back(std::move(t));
+            notify_worker();
+        });
+    }
+
+    /**
+     * @brief 设置 submit_once 的结果缓存时长（默认 0：完成即失效，只合并同时在途的请求）
+     */
+    void set_once_ttl(std::chrono::milliseconds ttl) {
+        flights.set_ttl(ttl);
+    }
+
+    /**
+     * @brief 按 key 亲和地提交：同一 key 的任务优先投递到同一个 worker 的私有 mailbox，数据留在其缓存中
+     *
+     * key 经一致性哈希映射到 worker（增删 worker 只迁移约 1/N 的 key）；归属 worker 的待执行定向任务数
+     * 达到上限 max(ceil(c * (总数 + 1) / N), 4) 时溢出到环上的下一个 worker（c 见 set_keyed_balance）。
+     * 有 worker 正在退出时退回共享队列。定向任务与 broadcast 一样优先于共享队列执行，且不会被其他 worker 取走。
+     */
+    template <typename K, typename F, typename R = result_of_t<F>,
+              typename DR = typename std::enable_if<std::is_void<R>::value>::type>
+    void submit_keyed(const K &key, F &&task) {
+        ensure_open();
+        post_keyed(key_hash(key), wrap_void(std::forward<F>(task)));
+    }
+
+    template <typename K, typename F, typename R = result_of_t<F>,
+              typename DR = typename std::enable_if<!std::is_void<R>::value, R>::type>
+    auto submit_keyed(const K &key, F &&task) -> std::future<R> {
+        ensure_open();
+        auto task_promise = std::make_shared<std::promise<R>>();
+        post_keyed(key_hash(key), wrap_value<R>(std::forward<F>(task), task_promise));
+        return task_promise->get_future();
+    }
+
+    /**
+     * @brief 设置 submit_keyed 的负载上限系数 c（默认 1.25，至少为 1）；越大越偏向归属 worker，越小越均衡
+     */
+    void set_keyed_balance(double c) {
+        std::lock_guard<std::mutex> lock(lok);
+        keyed_balance = std::max(c, 1.0);
+    }
+
+    /**
+     * @brief 带成本提示的提交：任务的预估耗时计入分支的未完成工作量，使 expected_delay() 按工作量而非任务数估算
+     * @param hint 显式耗时（如 std::chrono::milliseconds(10)），或 tag（如 "resize"）：按该 tag 的历史执行耗时估算，
+     *             任务执行时自动打上该 tag 并计时学习；都没有可用数据时按分支的平均执行耗时估算
+     */
+    template <typename F, typename R = result_of_t<F>,
+              typename DR = typename std::enable_if<std::is_void<R>::value>::type>
+    void submit_costed(const costHint &hint, F &&task) {
+        ensure_open();
+        tq.push_back(wrap_costed(hint, wrap_void(std::forward<F>(task))));
+        notify_worker();
+    }
+
+    template <typename F, typename R = result_of_t<F>,
+              typename DR = typename std::enable_if<!std::is_void<R>::value, R>::type>
+    auto submit_costed(const costHint &hint, F &&task) -> std::future<R> {
+        ensure_open();
+        auto task_promise = std::make_shared<std::promise<R>>();
+        tq.push_back(wrap_costed(hint, wrap_value<R>(std::forward<F>(task), task_promise)));
+        notify_worker();
+        return task_promise->get_future();
+    }
+
+    /**
+     * @brief 按 tag 学习到的执行耗时（submit_costed 以 tag 提交的任务），尚无样本时为 0
+     */
+    std::chrono::nanoseconds learned_cost(const char *tag) const {
+        return std::chrono::nanoseconds(costs.estimate(tag));
+    }
+
+    /**
+     * @brief 在当前每个 worker 上各执行一次 task（例如刷新线程局部缓存）
+     * @return 所有 worker 都执行完后就绪的 future；任一次执行抛出异常时，future 携带第一个异常
+     *
+     * 任务投递到各 worker 的私有 mailbox，worker 在完成手头任务后优先执行它，不会被其他 worker 取走；
+     * 与 wait_tasks 不同，分支不会暂停。每个 worker 执行的是 task 的一份独立拷贝。
+     */
+    template <typename F>
+    std::future<void> broadcast(F &&task) {
+        ensure_open();
+        auto proto = std::decay_t<F>(std::forward<F>(task));
+        auto state = std::make_shared<broadcastState>();
+        auto fut = state->done.get_future();
+        std::lock_guard<std::mutex> lock(lok);
+        if (contexts.empty()) {
+            state->done.set_value();
+            return fut;
+        }
+        state->left.store(contexts.size(), std::memory_order_relaxed);
+        for (workerContext *ctx : contexts) {
+            ctx->mailbox.push_back([fn = proto, state]() mutable {
                 try {
-                    task_promise->set_exception(std::current_exception());
-                } catch (const std::exception &ex) {
-                    std::cerr << "workbranch: worker[" << std::this_thread::get_id()
-                              << "] caught exception while setting promise:\n  what(): " << ex.what() << '\n'
-                              << std::flush;
+                    fn();
                 } catch (...) {
-                    std::cerr << "workbranch: worker[" << std::this_thread::get_id()
-                              << "] caught unknown exception while setting promise\n"
-                              << std::flush;
+                    if (!state->failed.exchange(true)) state->error = std::current_exception();
+                }
+                // 最后一个完成者兑现 future；acq_rel 保证能看到其他 worker 写入的 error
+                if (state->left.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    if (state->error) {
+                        state->done.set_exception(state->error);
+                    } else {
+                        state->done.set_value();
+                    }
                 }
+            });
+            ctx->mail.fetch_add(1, std::memory_order_relaxed);
+        }
+        mailed.fetch_add(contexts.size(), std::memory_order_relaxed);
+        if (may_park()) task_cv.notify_all();
+        return fut;
+    }
+
+    /**
+     * @brief 关闭分支
+     * @param mode drain：不再接受提交，worker 并行清空所有队列后退出；
+     *             abort：不再接受提交，所有排队任务不再执行，其 future 以 task_cancelled 失败
+     * @param timeout 毫秒，默认无限等待。drain 超时后剩余排队任务按 abort 处理
+     * @return 所有 worker 是否在 timeout 内退出（正在执行的任务不会被打断）
+     *
+     * 关闭后再 submit 会抛出 std::runtime_error；析构时无需再等待。
+     */
+    bool shutdown(shutdownMode mode, unsigned timeout = static_cast<unsigned>(-1)) {
+        using namespace std::chrono;
+        bool unlimited = timeout == static_cast<unsigned>(-1);
+        auto deadline = unlimited ? steady_clock::time_point::max() : steady_clock::now() + milliseconds(timeout);
+        closed.store(true);
+
+        if (mode == shutdownMode::drain) {
+            // 所有 worker 报告空闲即表示各队列已被并行清空
+            wait_idle(deadline);
+        }
+        // abort，或 drain 超时后剩余的任务：此后 worker 取到的任务同样以取消模式执行，
+        // 每个排队任务要么已在此之前开始执行，要么被取消，不会两者兼有
+        aborting.store(true);
+        cancel_pending();
+
+        bool all_exited;
+        {
+            std::unique_lock<std::mutex> lock(lok);
+            decline = workers.size();
+            destructing = true;
+            if (may_park()) task_cv.notify_all();
+            token_cv.notify_all();
+            auto done = [this] { return !decline; };
+            if (unlimited) {
+                thread_cv.wait(lock, done);
+                all_exited = true;
+            } else {
+                all_exited = thread_cv.wait_until(lock, deadline, done);
             }
-        });
-        if (wait_strategy == waitStrategy::blocking) task_cv.notify_one();
-        return task_promise->get_future();
+        }
+        // worker 退出时会把 next 槽中的任务交还全局队列，这里一并取消
+        cancel_pending();
+        return all_exited;
     }
 
 private:
@@ -296,13 +900,41 @@ private:
 
 private:
     // 主循环（worker 运行体），在单独线程中执行
-    void mission() {
+    void mission(workerContext *registered) {
         task_t task;
         int spin_count = 0;
+        adaptiveSpin adapt(max_spin_count);
+        // 上下文已由 add_worker 登记在 contexts / keyed_ring 中；线程退出时随之释放
+        std::unique_ptr<workerContext> owned(registered);
+        workerContext &ctx = *owned;
+        local_worker() = &ctx;
+        {
+            std::lock_guard<std::mutex> lock(lok);
+            ctx.tag = &current_task_tag();
+        }
 
         while (true) {
-            // 优先：当没有退出请求且队列有任务时，立刻取并执行任务
-            if (decline <= 0 && tq.try_pop(task)) {
+            // 优先：私有 mailbox 中的定向任务（即使有退出请求也先执行完）；
+            // 其次：当没有退出请求且 next 槽或队列有任务时，立刻取并执行任务
+            if (take(task, ctx)) {
+                if (wait_strategy == waitStrategy::adaptive && adapt.is_idle()) {
+                    adapt.on_task(std::chrono::steady_clock::now());
+                }
+                signal.active.fetch_add(1, std::memory_order_relaxed);
+                // shutdown 放弃排队任务之后取到的任务只做取消处理
+                bool cancel = aborting.load();
+                bool timed = timing_enabled.load(std::memory_order_relaxed)
+                             || admission_enabled.load(std::memory_order_relaxed);
+                bool cpu_timed = cpu_enabled.load(std::memory_order_relaxed);
+                bool watched = watch_enabled.load(std::memory_order_relaxed);
+                // 未开启统计时每 service_sample_every 个任务采样一次耗时，维持负载信号中的 EWMA
+                bool sampled = ++ctx.sample_tick % service_sample_every == 0;
+                auto start = timed || watched || sampled ? std::chrono::steady_clock::now()
+                                                         : std::chrono::steady_clock::time_point{};
+                auto cpu_start = cpu_timed ? cpuAccount::thread_now() : std::chrono::nanoseconds{};
+                current_task_tag().store(nullptr, std::memory_order_relaxed);
+                if (watched) ctx.task_start_ns.store(start.time_since_epoch().count(), std::memory_order_relaxed);
+                cancelling() = cancel;
                 try {
                     task();
                 } catch (...) {
@@ -311,15 +943,47 @@ private:
                               << "] unexpected exception in task\n"
                               << std::flush;
                 }
+                cancelling() = false;
+                if ((timed || sampled) && !ctx.discarded) {
+                    auto elapsed = std::chrono::steady_clock::now() - start;
+                    if (timed) {
+                        svc_hist.record(elapsed);
+                        admission.on_service(elapsed);
+                    }
+                    publish_service(elapsed);
+                }
+                if (cpu_timed && !ctx.discarded) {
+                    cpu_acct.record(current_task_tag().load(std::memory_order_relaxed), ctx.has_tenant ? &ctx.tenant : nullptr,
+                                    cpuAccount::thread_now() - cpu_start, std::chrono::steady_clock::now());
+                }
+                if (watched) ctx.task_start_ns.store(0, std::memory_order_relaxed);
+                ctx.discarded = false;
+                signal.active.fetch_sub(1, std::memory_order_relaxed);
                 spin_count = 0;
             }
             // 有退出请求（del_worker 或 析构时设置的 decline）
             else if (decline > 0) {
-                std::lock_guard<std::mutex> lock(lok);
+                std::unique_lock<std::mutex> lock(lok);
                 // double-check：在加锁后再次检测并递减 decline
-                if (decline > 0 && decline--) {
+                if (decline > 0 && ctx.mailbox.empty() && decline--) {
+                    // next 槽中尚未执行的任务交还全局队列，由其他 worker 继续处理；
+                    // shutdown 已放弃排队任务时（其取消可能已经结束）就地取消
+                    if (ctx.next) {
+                        if (aborting.load()) {
+                            cancelling() = true;
+                            ctx.next();
+                            cancelling() = false;
+                        } else {
+                            tq.push_back(std::move(ctx.next));
+                        }
+                        ctx.next = nullptr;
+                    }
+                    local_worker() = nullptr;
+                    contexts.erase(std::find(contexts.begin(), contexts.end(), &ctx));
+                    keyed_ring.remove(&ctx, ctx.slot);
                     // 从 workers 容器中移除自身（key 为当前线程 id）
                     workers.erase(std::this_thread::get_id());
+                    signal.workers.store(workers.size(), std::memory_order_relaxed);
                     // 如果当前处于 wait_tasks 的 is_waiting 阶段，需上报 task_done
                     if (m_is_waiting) task_done_cv.notify_one();
                     // 如果正在析构，通知析构等待者（~workbranch）
@@ -327,19 +991,30 @@ private:
                     // 线程退出（mission 返回）
                     return;
                 }
+                // mailbox 中的定向任务仍需执行但限速令牌不足：睡到下一个令牌产生，而不是空转
+                if (!ctx.mailbox.empty() && rate_limited.load(std::memory_order_relaxed)) {
+                    auto when = bucket.next_token();
+                    token_cv.wait_until(lock, when, [this, when] {
+                        return !rate_limited.load(std::memory_order_relaxed) || bucket.next_token() != when;
+                    });
+                }
+            }
+            // 有任务排队但限速令牌不足
+            else if (rate_limited.load(std::memory_order_relaxed) && has_pending(ctx)) {
+                wait_token();
             }
             // 没有任务也没有退出请求
             else {
                 if (m_is_waiting) {
-                    // wait_tasks 协商的第一阶段：上报自己已空闲并阻塞等待恢复
+                    // wait_tasks 协商：上报自己已空闲并阻塞到本轮等待结束
                     std::unique_lock<std::mutex> locker(lok);
-                    task_done_workers++;
-                    task_done_cv.notify_one(); // 告知等待者（wait_tasks）已有一个 worker 报告空闲
-                    // 阻塞直到 is_waiting 变为 false（由 wait_tasks 恢复）
-                    thread_cv.wait(locker, [this] { return !m_is_waiting; });
-                    // 恢复后上报已恢复
-                    waiting_finished_worker++;
-                    if (waiting_finished_worker >= workers.size()) waiting_finished.notify_one();
+                    // 加锁后复查：本轮可能已经结束（超时或已完成），此时不能计入下一轮
+                    if (m_is_waiting) {
+                        size_t round = wait_round;
+                        task_done_workers++;
+                        task_done_cv.notify_one(); // 告知等待者（wait_tasks）已有一个 worker 报告空闲
+                        thread_cv.wait(locker, [this, round] { return wait_round != round; });
+                    }
                 } else {
                     // 根据等待策略采取相应动作
                     switch (wait_strategy) {
@@ -358,11 +1033,17 @@ private:
                         break;
                     }
                     case waitStrategy::blocking: {
-                        std::unique_lock<std::mutex> locker(lok);
-                        // 阻塞直到有任务、或被请求等待、或析构/退出请求
-                        task_cv.wait(locker, [this] {
-                            return tq.getLength() > 0 || m_is_waiting || destructing || decline > 0;
-                        });
+                        park(ctx);
+                        break;
+                    }
+                    case waitStrategy::adaptive: {
+                        if (!adapt.is_idle()) adapt.on_idle(std::chrono::steady_clock::now());
+                        if (spin_count < adapt.budget()) {
+                            ++spin_count;
+                            std::this_thread::yield();
+                        } else {
+                            park(ctx);
+                        }
                         break;
                     }
                     } // switch
@@ -371,6 +1052,284 @@ private:
         }             // while
     }
 
+    // 取下一个任务：优先私有 mailbox，其次（没有退出请求时）next 槽与各队列；
+    // 限速时先确认有任务可取再取令牌，最终没有取到任务则归还令牌
+    bool take(task_t &task, workerContext &ctx) {
+        if (!rate_limited.load(std::memory_order_relaxed)) {
+            return take_mail(task, ctx) || (decline <= 0 && take_task(task, ctx));
+        }
+        if (!has_pending(ctx) || !bucket.try_acquire()) return false;
+        if (take_mail(task, ctx) || (decline <= 0 && take_task(task, ctx))) return true;
+        bucket.refund();
+        return false;
+    }
+
+    // 本 worker 是否可能取到任务（无锁近似）
+    bool has_pending(const workerContext &ctx) const {
+        if (ctx.mail.load(std::memory_order_relaxed) > 0) return true;
+        return decline <= 0 && (ctx.next || tq.getLength() > 0 || fq.getLength() > 0 || bq.getLength() > 0);
+    }
+
+    // 睡到下一个令牌产生；退出请求、析构或调整限速时提前醒来
+    void wait_token() {
+        auto when = bucket.next_token();
+        std::unique_lock<std::mutex> locker(lok);
+        token_cv.wait_until(locker, when, [this, when] {
+            return decline > 0 || destructing || bucket.next_token() != when;
+        });
+    }
+
+    // 从 next 槽或队列取任务：优先 next 槽（受 max_lifo_streak 限制），其次全局队列
+    bool take_task(task_t &task, workerContext &ctx) {
+        ctx.has_tenant = false;
+        if (ctx.next) {
+            if (++ctx.lifo_streak <= max_lifo_streak) {
+                task = std::move(ctx.next);
+                ctx.next = nullptr;
+                return true;
+            }
+            // 连续命中达到上限：让位到队列尾部，先服务队列中等待的任务
+            tq.push_back(std::move(ctx.next));
+            ctx.next = nullptr;
+        }
+        ctx.lifo_streak = 0;
+        // 全局队列与租户公平队列轮流优先，一方为空时取另一方
+        ctx.fair_turn = !ctx.fair_turn;
+        if (ctx.fair_turn ? take_fair(task, ctx) || tq.try_pop(task) : tq.try_pop(task) || take_fair(task, ctx)) {
+            return true;
+        }
+        // 前台队列都为空时才执行后台任务；每个任务结束后重新检查前台，即在任务边界被抢占
+        return bq.try_pop(task);
+    }
+
+    // 从私有 mailbox 取定向任务；mail 为 0 时只有一次原子读
+    bool take_mail(task_t &task, workerContext &ctx) {
+        if (ctx.mail.load(std::memory_order_relaxed) == 0) return false;
+        std::lock_guard<std::mutex> lock(lok);
+        if (ctx.mailbox.empty()) return false;
+        task = std::move(ctx.mailbox.front());
+        ctx.mailbox.pop_front();
+        ctx.mail.fetch_sub(1, std::memory_order_relaxed);
+        mailed.fetch_sub(1, std::memory_order_relaxed);
+        ctx.has_tenant = false;
+        return true;
+    }
+
+    // submit_costed 的包装：入队时把预估耗时计入未完成工作量，执行（或被取消）后扣除；以 tag 提示的任务计时学习
+    task_t wrap_costed(const costHint &hint, task_t inner) {
+        uint64_t cost = hint.ns ? hint.ns : hint.tag ? costs.estimate(hint.tag) : 0;
+        if (!cost) cost = signal.service_ns.load(std::memory_order_relaxed);
+        if (!cost) cost = 1;
+        signal.work_ns.fetch_add(cost, std::memory_order_relaxed);
+        signal.costed.fetch_add(1, std::memory_order_relaxed);
+        const char *tag = hint.ns ? nullptr : hint.tag;
+        return [this, cost, tag, inner = std::move(inner)]() {
+            if (tag && !cancelling()) {
+                current_task_tag().store(tag, std::memory_order_relaxed);
+                auto start = std::chrono::steady_clock::now();
+                inner();
+                costs.learn(tag, std::chrono::steady_clock::now() - start);
+            } else {
+                inner();
+            }
+            signal.work_ns.fetch_sub(cost, std::memory_order_relaxed);
+            signal.costed.fetch_sub(1, std::memory_order_relaxed);
+        };
+    }
+
+    // 把一次耗时样本并入 EWMA（系数 1/8）；多个 worker 并发写入时可能丢失个别样本，对路由无影响
+    void publish_service(std::chrono::steady_clock::duration elapsed) {
+        uint64_t ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        uint64_t old = signal.service_ns.load(std::memory_order_relaxed);
+        signal.service_ns.store(old ? old - (old >> 3) + (ns >> 3) : (ns ? ns : 1), std::memory_order_relaxed);
+    }
+
+    // submit_keyed 的投递：按哈希值在环上选择 worker，选不到时退回共享队列
+    void post_keyed(uint64_t h, task_t task) {
+        {
+            std::lock_guard<std::mutex> lock(lok);
+            // 有退出请求时不再定向投递，避免退出中的 worker 因 mailbox 非空而迟迟不能退出
+            workerContext *home = decline > 0 ? nullptr
+                                              : keyed_ring.pick(
+                                                    h, keyed_balance, mailed.load(std::memory_order_relaxed),
+                                                    [](workerContext *c) { return c->mailbox.size(); }, keyed_floor);
+            if (home) {
+                home->mailbox.push_back(std::move(task));
+                home->mail.fetch_add(1, std::memory_order_relaxed);
+                mailed.fetch_add(1, std::memory_order_relaxed);
+                // task_cv 上无法只唤醒指定的 worker：仅当目标挂起时才全部唤醒
+                if (home->sleeping) task_cv.notify_all();
+                return;
+            }
+        }
+        tq.push_back(std::move(task));
+        notify_worker();
+    }
+
+    // 从租户公平队列出队；配置了 CPU 配额时超额租户被降级
+    bool take_fair(task_t &task, workerContext &ctx) {
+        bool ok;
+        if (cpu_acct.any_quota()) {
+            auto now = std::chrono::steady_clock::now();
+            ok = fq.try_pop(task, &ctx.tenant, [this, now](tenant_t t) { return cpu_acct.over_quota(t, now); });
+        } else {
+            ok = fq.try_pop(task, &ctx.tenant);
+        }
+        ctx.has_tenant = ok;
+        return ok;
+    }
+
+    // 准入判断：预测排队时间不超过 slo 才接受
+    bool admit(std::chrono::microseconds slo) {
+        if (!admission_enabled.load(std::memory_order_relaxed)) return true;
+        if (admission.predict(tq.getLength(), signal.workers.load(std::memory_order_relaxed)) <= slo) return true;
+        admission.count_rejected();
+        return false;
+    }
+
+    // 出队时的 CoDel 判断：存在常驻队列且该任务已超出 SLO 时削减
+    bool shed_on_dequeue(std::chrono::steady_clock::time_point enqueued, std::chrono::microseconds slo) {
+        if (!admission_enabled.load(std::memory_order_relaxed)) return false;
+        auto now = std::chrono::steady_clock::now();
+        auto sojourn = now - enqueued;
+        admission.on_sojourn(sojourn, now);
+        if (admission.standing_queue() && sojourn > slo) {
+            admission.count_rejected();
+            if (workerContext *ctx = local_worker()) ctx->discarded = true;
+            return true;
+        }
+        return false;
+    }
+
+    // 分支是否饱和：所有 worker 都在执行任务，且队列积压超过 inline_threshold
+    bool saturated() {
+        return signal.active.load(std::memory_order_relaxed) >= signal.workers.load(std::memory_order_relaxed)
+               && tq.getLength() > inline_threshold.load(std::memory_order_relaxed);
+    }
+
+    // 关闭后拒绝提交
+    void ensure_open() const {
+        if (closed.load(std::memory_order_relaxed)) {
+            throw std::runtime_error("workbranch: submit after shutdown");
+        }
+    }
+
+    // 包装 void 任务：worker 中捕获并记录异常；被 abort 取消时直接跳过
+    template <typename F>
+    static task_t wrap_void(F &&task) {
+        return [fn = std::decay_t<F>(std::forward<F>(task))]() mutable {
+            if (cancelling()) return;
+            run_logged(fn);
+        };
+    }
+
+    // 包装 cancel_aware 任务：与 wrap_void 相同，但被 abort 取消时仍调用
+    template <typename F>
+    static task_t wrap_aware(F &&task) {
+        return [fn = std::decay_t<F>(std::forward<F>(task))]() mutable {
+            run_logged(fn);
+        };
+    }
+
+    // 执行 void 任务，捕获并记录异常
+    template <typename F>
+    static void run_logged(F &fn) {
+        try {
+            fn();
+        } catch (const std::exception &ex) {
+            std::cerr << "workbranch: worker[" << std::this_thread::get_id()
+                      << "] caught exception:\n  what(): " << ex.what() << '\n'
+                      << std::flush;
+        } catch (...) {
+            std::cerr << "workbranch: worker[" << std::this_thread::get_id()
+                      << "] caught unknown exception\n"
+                      << std::flush;
+        }
+    }
+
+    // 包装返回值任务：结果或异常写入 promise；被 abort 取消时写入 task_cancelled
+    template <typename R, typename F>
+    static task_t wrap_value(F &&task, std::shared_ptr<std::promise<R>> task_promise) {
+        return [exec = std::decay_t<F>(std::forward<F>(task)), task_promise]() mutable {
+            if (cancelling()) {
+                task_promise->set_exception(
+                    std::make_exception_ptr(task_cancelled("workbranch: cancelled by shutdown")));
+                return;
+            }
+            try {
+                fulfil(*task_promise, exec);
+            } catch (...) {
+                task_promise->set_exception(std::current_exception());
+            }
+        };
+    }
+
+    // wait_tasks / shutdown(drain) 的实现：等待所有 worker 报告空闲，最迟到 deadline
+    bool wait_idle(std::chrono::steady_clock::time_point deadline) {
+        bool res;
+        {
+            std::unique_lock<std::mutex> locker(lok);
+            m_is_waiting = true; // worker 将上报空闲
+            if (may_park()) task_cv.notify_all();
+            auto idle = [this] { return task_done_workers >= workers.size(); };
+            if (deadline == std::chrono::steady_clock::time_point::max()) {
+                task_done_cv.wait(locker, idle);
+                res = true;
+            } else {
+                res = task_done_cv.wait_until(locker, deadline, idle);
+            }
+            // 结束本轮：清理计数、关闭等待标志并推进轮次（已上报的 worker 据此恢复）
+            task_done_workers = 0;
+            m_is_waiting = false;
+            ++wait_round;
+        }
+        thread_cv.notify_all();
+        return res;
+    }
+
+    // 在当前线程上取出所有排队任务并以取消模式执行（void 任务被跳过，future 以 task_cancelled 失败）
+    void cancel_pending() {
+        cancelling() = true;
+        task_t task;
+        while (tq.try_pop(task) || fq.try_pop(task) || bq.try_pop(task)) {
+            task();
+        }
+        cancelling() = false;
+    }
+
+    // 当前线程所属 worker 的上下文（非 worker 线程为 nullptr）
+    static workerContext *&local_worker() {
+        static thread_local workerContext *ctx = nullptr;
+        return ctx;
+    }
+
+    // 挂起当前 worker，直到有任务、或被请求等待、或析构/退出请求
+    // parked 计数与 notify_worker() 配合，保证提交方不会错过挂起中的 worker
+    void park(workerContext &ctx) {
+        std::unique_lock<std::mutex> locker(lok);
+        parked.fetch_add(1);
+        ctx.sleeping = true;
+        task_cv.wait(locker, [this, &ctx] {
+            return tq.getLength() > 0 || fq.getLength() > 0 || bq.getLength() > 0 || !ctx.mailbox.empty()
+                   || m_is_waiting || destructing || decline > 0;
+        });
+        ctx.sleeping = false;
+        parked.fetch_sub(1);
+    }
+
+    // 提交任务后唤醒一个挂起的 worker；没有挂起者时只有一次原子读
+    void notify_worker() {
+        if (parked.load() > 0) {
+            std::lock_guard<std::mutex> lock(lok);
+            task_cv.notify_one();
+        }
+    }
+
+    // blocking / adaptive 策略下 worker 会挂起在 task_cv 上
+    bool may_park() const noexcept {
+        return wait_strategy == waitStrategy::blocking || wait_strategy == waitStrategy::adaptive;
+    }
+
     // 递归顺序执行辅助（sequence 提交使用）
     template <typename F>
     void rexec(F &&func) {
@@ -384,26 +1343,56 @@ private:
     }
 
 private:
-    const int max_spin_count = 10000; // balance 策略忙等上限（可调）
+    const int max_spin_count = 10000; // balance 策略忙等上限 / adaptive 策略自旋预算上限（可调）
+    const int max_lifo_streak = 3;    // 连续从 next 槽执行的上限（公平性）
+    const size_t keyed_floor = 4;     // submit_keyed：mailbox 中少于该数的定向任务不视为过载
+    const uint32_t service_sample_every = 16; // 未开启耗时统计时的负载信号采样间隔
 
     // 工作线程容器与任务队列
     worker_map workers = {};
+    std::vector<workerContext *> contexts = {}; // 各 worker 的上下文（受 lok 保护）
+    hashRing<workerContext *> keyed_ring;       // submit_keyed 的 worker 哈希环（受 lok 保护）
+    uint64_t next_slot = 0;                     // 下一个 worker 的环上编号（受 lok 保护）
+    std::atomic<size_t> mailed = {0};           // 所有 mailbox 中的任务总数（在 lok 下修改）
+    double keyed_balance = 1.25;                // submit_keyed 的负载上限系数（受 lok 保护）
+    std::vector<stuckTask> stuck = {};          // 最近一次扫描发现的卡住任务（受 lok 保护）
+    std::atomic<size_t> nstuck = {0};
+    stuckHandlerT stuck_handler = {};           // 卡住任务回调（受 lok 保护）
+    std::atomic<bool> watch_enabled = {false};  // 是否记录任务开始时间戳
     taskQueue<task_t> tq = {};
+    fairQueue<task_t> fq = {}; // 多租户任务的加权公平队列
+    taskQueue<task_t> bq = {}; // 后台任务队列（只用空闲时间）
+    singleflight flights;     // submit_once 的在途 key 表
 
     // 策略与协商/状态
     waitStrategy wait_strategy = {};
     size_t decline = 0;                 // 希望退出的线程数量（del_worker 或 析构时设置）
     size_t task_done_workers = 0;       // wait_tasks 阶段：上报空闲的 worker 数
-    size_t waiting_finished_worker = 0; // wait_tasks 恢复阶段：已恢复的 worker 数
+    size_t wait_round = 0;              // wait_tasks 轮次，每轮结束时递增（已上报的 worker 据此恢复）
     bool m_is_waiting = false;          // 是否正在进行 wait_tasks 的等待阶段
     bool destructing = false;           // 析构中标志
+    std::atomic<bool> closed = {false};   // shutdown 后拒绝新提交
+    std::atomic<bool> aborting = {false}; // shutdown 已放弃排队任务：worker 取到的任务以取消模式执行
+    std::atomic<size_t> parked = {0};           // 挂起在 task_cv 上的 worker 数
+    std::atomic<bool> lifo_enabled = {false};   // 是否启用 LIFO next 槽（默认关闭）
+    loadSignal signal;                          // worker 数、忙碌 worker 数、执行耗时 EWMA 与未完成工作量
+    costTable costs;                            // submit_costed 按 tag 学习的执行耗时
+    std::atomic<size_t> inline_threshold = {0}; // inline_if_busy 的队列积压阈值
+    std::atomic<bool> timing_enabled = {false}; // 是否统计任务执行耗时
+    latencyHistogram svc_hist;                  // 任务执行耗时分布
+    std::atomic<bool> admission_enabled = {false}; // 是否开启准入控制
+    admissionController admission;                 // sheddable 任务的准入控制状态
+    std::atomic<bool> cpu_enabled = {false};       // 是否开启 CPU 记账
+    cpuAccount cpu_acct;                           // 按 tag / 租户的 CPU 时间与配额
+    std::atomic<bool> rate_limited = {false};      // 是否限制开始执行任务的速率
+    tokenBucket bucket;                            // set_rate_limit 的令牌桶
 
     // 同步原语
     std::mutex lok;
     std::condition_variable thread_cv;        // 用于析构/恢复唤醒
     std::condition_variable task_done_cv;     // wait_tasks 等待空闲 worker 的计数唤醒
-    std::condition_variable task_cv;          // blocking 策略下用于唤醒有任务的 worker
-    std::condition_variable waiting_finished; // wait_tasks 等待恢复完成
+    std::condition_variable task_cv;          // blocking / adaptive 策略下用于唤醒有任务的 worker
+    std::condition_variable token_cv;         // 限速时等待令牌的 worker
 };
 
 } // namespace details
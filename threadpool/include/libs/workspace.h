@@ -1,17 +1,30 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <chrono>
 #include <future>
 #include <iterator>
 #include <list>
 #include <map>
 #include <memory>
+#include <stdexcept>
+#include <string>
+#include <typeindex>
+#include <typeinfo>
 #include <type_traits>
 #include <utility>
+#include <vector>
 #include <functional>
 #include <iostream>
 
+#include "libs/hashring.h"
+#include "libs/remote.h"
+#include "libs/singleflight.h"
 #include "libs/supervisor.h"
+#include "libs/timer.h"
 #include "libs/utility.h"
 #include "libs/workbranch.h"
 
@@ -23,12 +36,28 @@ namespace sunshine {
 namespace task {
 using urg = details::urgent;
 using nor = details::normal;
+using fifo = details::fifo;
 using seq = details::sequence;
+using inl = details::inline_if_busy;
+using shed = details::sheddable;
+using bg = details::background;
 } // namespace task
 
+// 分支类别别名（workspace::attach<cls> / submit<cls>）
+namespace pool {
+using cpu = details::cpu_bound;
+using io = details::io_bound;
+using latency = details::latency_critical;
+} // namespace pool
+
 // 为外部使用提供便捷别名
 using workbranch = details::workbranch;
 using supervisor = details::supervisor;
+using task_rejected = details::task_rejected;
+using task_cancelled = details::task_cancelled;
+using details::tagged;
+using costHint = details::costHint;
+using branch_class = details::branch_class;
 template <typename RT>
 using futures = details::futures<RT>;
 
@@ -43,7 +72,9 @@ namespace sunshine {
  * 设计要点：
  * - workspace 独占拥有 workbranch / supervisor（使用 std::unique_ptr）
  * - 提供 attach/detach 将对象加入/取出（detach 会把所有权返回给调用者）
- * - 使用一个迭代器 cur 做轮询式的负载分配（结合相邻节点的任务数量比较）
+ * - 负载分配：随机采样 d 个分支（默认 2），提交到预期时延最小者（join-shortest-expected-delay），
+ *   负载信号由各分支无锁发布，路由不获取任何队列锁
+ * - 分支类别：attach<cls> 接管的分支只接收 submit<cls>；不带类别的 submit 系列只在未分类的分支间路由
  *
  * 注意：
  * - 本类**非线程安全**：若在多线程环境并发调用 attach/detach/submit，需在外部加锁或在此处添加互斥保护。
@@ -107,6 +138,34 @@ public:
         }
     };
 
+    // ----------------------------
+    // rid: 进程外分支句柄（轻量）
+    // ----------------------------
+    class rid {
+        remoteBranch *ptr = nullptr;
+        friend class workspace;
+
+    public:
+        explicit rid(remoteBranch *r) noexcept :
+            ptr(r) {
+        }
+
+        bool operator==(const rid &other) const noexcept {
+            return ptr == other.ptr;
+        }
+        bool operator!=(const rid &other) const noexcept {
+            return ptr != other.ptr;
+        }
+        bool operator<(const rid &other) const noexcept {
+            return ptr < other.ptr;
+        }
+
+        friend std::ostream &operator<<(std::ostream &os, const rid &other) {
+            os << reinterpret_cast<uint64_t>(other.ptr);
+            return os;
+        }
+    };
+
 public:
     explicit workspace() = default;
 
@@ -116,8 +175,11 @@ public:
 
     ~workspace() {
         // 显式清理：虽然容器会自动析构，这里显式清理能在析构日志/调试时更清晰地表达资源释放顺序
+        // 先停定时器，避免对冲回调向正在析构的分支提交任务
+        m_timer.reset();
         m_branchList.clear();
         m_superMap.clear();
+        m_remoteList.clear();
     }
 
     // ----------------------------
@@ -127,7 +189,18 @@ public:
     bid attach(workbranch *b) {
         assert(b != nullptr);
         m_branchList.emplace_back(b); // 将裸指针封装进 unique_ptr 并放入列表
-        cur = m_branchList.begin();   // 重置轮询游标到列表起始（可视为简单策略）
+        group(typeid(void)).branches.push_back(b);
+        m_branchRing.add(b, reinterpret_cast<uintptr_t>(b));
+        return bid(b);
+    }
+
+    // attach<cls>: 以类别 cls（派生自 branch_class，如 pool::io）接管分支，只接收 submit<cls>
+    template <typename C>
+    bid attach(workbranch *b) {
+        static_assert(details::is_branch_class<C>::value, "workspace: class tag must derive from branch_class");
+        assert(b != nullptr);
+        m_branchList.emplace_back(b);
+        group(typeid(C)).branches.push_back(b);
         return bid(b);
     }
 
@@ -138,6 +211,14 @@ public:
         return sid(s);
     }
 
+    // attach 进程外分支（如 shmbranch），任务通过 submit_remote 提交
+    rid attach(remoteBranch *r) {
+        assert(r != nullptr);
+        m_remoteList.emplace_back(r);
+        rcur = m_remoteList.begin();
+        return rid(r);
+    }
+
     // ----------------------------
     // detach(bid): 从列表中移除指定 workbranch 并把所有权返回给调用者
     // 使用 move 的方式提取 unique_ptr（比 release + 重建更安全）
@@ -147,23 +228,15 @@ public:
             if (it->get() == b.ptr) {
                 // 先把该 unique_ptr 移出（不制造裸指针）
                 auto up = std::move(*it); // up 现在拥有该 workbranch
-
-                // 记录下一个迭代器，用于修正 cur（注意 std::list::erase 不影响其他迭代器）
-                auto next_it = std::next(it);
+                m_branchRing.remove(up.get(), reinterpret_cast<uintptr_t>(up.get()));
+                for (auto &kv : m_classes) {
+                    auto &vec = kv.second->branches;
+                    vec.erase(std::remove(vec.begin(), vec.end(), up.get()), vec.end());
+                }
 
                 // 删除容器中的节点
                 m_branchList.erase(it);
 
-                // 修正 cur：如果容器现在为空，cur 置为 end()
-                // 否则将 cur 指向原来的 next_it（若 next_it==end 则 wrap 到 begin）
-                if (m_branchList.empty()) {
-                    cur = m_branchList.end();
-                } else if (next_it == m_branchList.end()) {
-                    cur = m_branchList.begin();
-                } else {
-                    cur = next_it;
-                }
-
                 return up; // 所有权交给调用者
             }
         }
@@ -181,6 +254,21 @@ public:
         return up;
     }
 
+    // ----------------------------
+    // detach(rid): 移除进程外分支并返回所有权
+    // ----------------------------
+    auto detach(rid r) -> std::unique_ptr<remoteBranch> {
+        for (auto it = m_remoteList.begin(); it != m_remoteList.end(); ++it) {
+            if (it->get() == r.ptr) {
+                auto up = std::move(*it);
+                m_remoteList.erase(it);
+                rcur = m_remoteList.begin();
+                return up;
+            }
+        }
+        return nullptr;
+    }
+
     // ----------------------------
     // for_each: 遍历接口（以引用为参数更通用、安全）
     // ----------------------------
@@ -215,86 +303,294 @@ public:
         return *s.ptr;
     }
 
+    auto operator[](const rid &r) -> remoteBranch & {
+        return *r.ptr;
+    }
+
+    auto get_ref(const rid &r) -> remoteBranch & {
+        return *r.ptr;
+    }
+
     // ----------------------------
     // submit 模板重载：处理 void 返回、非 void 返回、以及 sequence（seq）任务
     // 这里使用 SFINAE（作为未命名默认模板参数）来区分不同情况
-    // 任务调度策略（每次提交都会 advance cur 并比较 cur 与 next 的负载，提交到任务更少的一方）
+    // 任务调度策略：见 route()，在采样的分支中选预期时延最小者
     // ----------------------------
 
     // 情况 A: 任务返回 void
     template <typename T = task::nor, typename F,
               typename R = details::result_of_t<F>,
-              typename DR = typename std::enable_if<std::is_void<R>::value>::type>
+              typename DR = typename std::enable_if<std::is_void<R>::value && !details::is_branch_class<T>::value>::type>
     void submit(F &&task) {
-        assert(!m_branchList.empty());
-        // this_br 是当前 cur 指向的分支（在调用 forward 之前）
-        auto this_br = cur->get();
-        // forward(cur) 会把 cur 前进到下一个位置（环回），并返回新的迭代器
-        auto next_br = forward(cur)->get();
-
-        // 选择任务量更少的分支来提交（局部负载比较）
-        if (next_br->num_tasks() < this_br->num_tasks()) {
-            next_br->submit<T>(std::forward<F>(task));
-        } else {
-            this_br->submit<T>(std::forward<F>(task));
-        }
+        route()->submit<T>(std::forward<F>(task));
     }
 
     // 情况 B: 任务有返回值 R（非 void）
     template <typename T = task::nor, typename F,
               typename R = details::result_of_t<F>,
-              typename DR = typename std::enable_if<!std::is_void<R>::value>::type>
+              typename DR = typename std::enable_if<!std::is_void<R>::value && !details::is_branch_class<T>::value>::type>
     auto submit(F &&task) -> std::future<R> {
-        assert(!m_branchList.empty());
-        auto this_br = cur->get();
-        auto next_br = forward(cur)->get();
-
-        if (next_br->num_tasks() < this_br->num_tasks()) {
-            return next_br->submit<T>(std::forward<F>(task));
-        } else {
-            return this_br->submit<T>(std::forward<F>(task));
-        }
+        return route()->submit<T>(std::forward<F>(task));
+    }
+
+    // 情况 B2: 可削减任务（只在 T == task::shed 时启用），受所选分支的准入控制（见 workbranch::enable_admission）
+    // void 任务返回是否被接受；返回值任务被拒绝时 future 以 task_rejected 失败
+    template <typename T, typename F,
+              typename = typename std::enable_if<std::is_same<T, task::shed>::value>::type>
+    auto submit(F &&task, std::chrono::microseconds slo) {
+        return route()->submit<T>(std::forward<F>(task), slo);
     }
 
     // 情况 C: sequence 类型的多任务提交（只在 T == task::seq 时启用）
     template <typename T, typename F, typename... Fs>
     auto submit(F &&f, Fs &&...fs)
         -> typename std::enable_if<std::is_same<T, task::seq>::value>::type {
-        assert(!m_branchList.empty());
-        auto this_br = cur->get();
-        auto next_br = forward(cur)->get();
-
-        if (next_br->num_tasks() < this_br->num_tasks()) {
-            next_br->submit<T>(std::forward<F>(f), std::forward<Fs>(fs)...);
-        } else {
-            this_br->submit<T>(std::forward<F>(f), std::forward<Fs>(fs)...);
+        route()->submit<T>(std::forward<F>(f), std::forward<Fs>(fs)...);
+    }
+
+    // 情况 D: 按 key 去重的提交（同 key 在任一分支排队/运行中时复用同一个 future）
+    template <typename F, typename R = details::result_of_t<F>>
+    auto submit_once(const std::string &key, F &&task) -> std::shared_future<R> {
+        // 与 workbranch::submit_once 相同：被 abort 取消时抛出 task_cancelled，由 singleflight 写入共享 future 并移除该 key
+        auto exec = [fn = std::decay_t<F>(std::forward<F>(task))]() mutable -> R {
+            if (details::cancelling()) throw details::task_cancelled("workspace: cancelled by shutdown");
+            return fn();
+        };
+        return m_flights.run(key, std::move(exec), [this](std::function<void()> &&t) {
+            route()->submit<details::cancel_aware>(std::move(t));
+        });
+    }
+
+    // 设置 submit_once 的结果缓存时长
+    void set_once_ttl(std::chrono::milliseconds ttl) {
+        m_flights.set_ttl(ttl);
+    }
+
+    // 情况 E: 对冲执行（适用于幂等、延迟长尾的任务）
+    // 首份副本提交到负载较轻的分支；delay 后仍未完成则向另一个分支再提交一份，先完成者胜出，
+    // 另一份若仍在排队，出队时直接丢弃。delay 为 0 时使用首发分支观测到的 p95 执行耗时
+    // （需对该分支 enable_timing(true)，没有样本时退化为 hedge_fallback）。
+    // 两份副本各持有 task 的一份拷贝，可能在两个线程上同时执行；只有一个未分类分支时不对冲。
+    // 注意：对冲副本在定时器线程上提交，期间不得 detach/销毁目标分支。
+    template <typename F, typename R = details::result_of_t<F>>
+    auto submit_hedged(F &&task, std::chrono::microseconds delay = std::chrono::microseconds(0)) -> std::future<R> {
+        // this_br 为首发（采样中预期时延最小者），next_br 为对冲目标；只有一个分支时二者相同
+        workbranch *next_br = nullptr;
+        workbranch *this_br = route(&next_br);
+
+        if (delay.count() <= 0) {
+            delay = std::chrono::duration_cast<std::chrono::microseconds>(this_br->service_time(0.95));
+            if (delay.count() <= 0) delay = hedge_fallback;
+        }
+
+        auto st = std::make_shared<hedgeState<R>>();
+        auto fut = st->task_promise.get_future();
+        std::function<R()> first = std::forward<F>(task);
+        std::function<R()> second = next_br != this_br ? first : nullptr;
+        this_br->submit<details::normal>([st, fn = std::move(first)]() mutable { st->run(fn); });
+        if (second) {
+            hedge_timer().add(delay, [st, next_br, second] {
+                if (!st->done.load()) next_br->submit<details::normal>([st, fn = second]() mutable { st->run(fn); });
+            });
         }
+        return fut;
+    }
+
+    // 情况 F: 进程外执行已注册的任务类型（type 与参数由服务端的 taskRegistry 解释）
+    // 与本地分支相同，比较相邻两个进程外分支的在途请求数，提交到较少的一方
+    template <typename R, typename Args>
+    auto submit_remote(uint32_t type, const Args &args) -> std::future<R> {
+        assert(!m_remoteList.empty());
+        auto this_rb = rcur->get();
+        if (++rcur == m_remoteList.end()) rcur = m_remoteList.begin();
+        auto next_rb = rcur->get();
+        if (next_rb->num_tasks() < this_rb->num_tasks()) return next_rb->submit<R>(type, args);
+        return this_rb->submit<R>(type, args);
+    }
+
+    // 情况 G: 按 key 亲和提交（同一 key 尽量落在同一分支的同一 worker 上，缓存保持热度）
+    // key 经一致性哈希映射到分支，归属分支排队任务数达到 max(ceil(c * (总数 + 1) / 分支数), 4) 时溢出到环上的下一个分支；
+    // 分支内再由 workbranch::submit_keyed 选择 worker。分支增删只迁移约 1/N 的 key。
+    template <typename K, typename F>
+    auto submit_keyed(const K &key, F &&task) {
+        assert(!m_branchRing.empty());
+        size_t total = 0;
+        for (workbranch *each : group(typeid(void)).branches) total += each->num_tasks();
+        // 分支层与 worker 层使用不相关的哈希值，避免同一分支的 key 在 worker 环上挤在一段弧内
+        uint64_t h = details::mix64(details::key_hash(key) ^ 0x5bd1e9955bd1e995ull);
+        auto br = m_branchRing.pick(h, m_keyedBalance, total, [](workbranch *b) { return b->num_tasks(); }, 4);
+        return br->submit_keyed(key, std::forward<F>(task));
+    }
+
+    // 情况 H: 带成本提示的提交（显式耗时或 tag，见 workbranch::submit_costed）
+    // 预估耗时计入目标分支的未完成工作量，之后的路由按工作量而非任务数比较，廉价与昂贵任务混合时也能均衡
+    template <typename F>
+    auto submit_costed(const details::costHint &hint, F &&task) {
+        return route()->submit_costed(hint, std::forward<F>(task));
+    }
+
+    // 情况 I: 按类别提交（cls 派生自 branch_class，如 pool::io），只在 attach<cls> 接管的分支间按预期时延路由
+    // 用法：submit<pool::io>(f)、submit<pool::cpu, task::urg>(f)、submit<pool::io, task::seq>(f1, f2)
+    template <typename C, typename T = task::nor, typename... Fs,
+              typename = typename std::enable_if<details::is_branch_class<C>::value>::type>
+    auto submit(Fs &&...fs) {
+        branchClass &cls = group(typeid(C));
+        cls.submitted.fetch_add(1, std::memory_order_relaxed);
+        return route(cls.branches)->template submit<T>(std::forward<Fs>(fs)...);
+    }
+
+    // 分支类别的汇总指标（无锁近似值）
+    struct classStats {
+        size_t branches = 0;    // 分支数
+        size_t workers = 0;     // worker 总数
+        size_t active = 0;      // 正在执行任务的 worker 数
+        size_t queued = 0;      // 排队任务数
+        uint64_t submitted = 0; // 经 submit<cls> 提交的任务数
+        double min_delay = 0;   // 各分支 expected_delay() 的最小值（纳秒）
+    };
+
+    // class_stats<pool::io>()；class_stats<void>() 为未分类的分支
+    template <typename C>
+    classStats class_stats() {
+        classStats st;
+        auto found = m_classes.find(std::type_index(typeid(C)));
+        if (found == m_classes.end()) return st;
+        branchClass &cls = *found->second;
+        st.branches = cls.branches.size();
+        st.submitted = cls.submitted.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < cls.branches.size(); ++i) {
+            workbranch *b = cls.branches[i];
+            st.workers += b->load_signal().workers.load(std::memory_order_relaxed);
+            st.active += b->load_signal().active.load(std::memory_order_relaxed);
+            st.queued += b->num_tasks();
+            double d = b->expected_delay();
+            if (i == 0 || d < st.min_delay) st.min_delay = d;
+        }
+        return st;
+    }
+
+    // 设置路由时采样的分支数 d（默认 2，至少为 1）；d 不小于分支数时比较全部分支
+    void set_route_samples(size_t d) {
+        m_routeSamples = std::max<size_t>(d, 1);
+    }
+
+    // 设置分支层 submit_keyed 的负载上限系数 c（默认 1.25，至少为 1）
+    void set_keyed_balance(double c) {
+        m_keyedBalance = std::max(c, 1.0);
     }
 
 private:
     // 别名，便于维护
     using workbranchList = std::list<std::unique_ptr<workbranch>>;
+    using remoteList = std::list<std::unique_ptr<remoteBranch>>;
     using supervisorMap = std::map<const supervisor *, std::unique_ptr<supervisor>>;
-    using pos_t = workbranchList::iterator;
 
-    // 轮询游标：指向当前选中的 workbranch 的 list 元素
-    pos_t cur = {};
+    // 一个分支类别：成员分支（供路由随机访问）与提交计数；typeid(void) 为未分类的分支
+    struct branchClass {
+        std::vector<workbranch *> branches;
+        std::atomic<uint64_t> submitted = {0};
+    };
+    using classMap = std::map<std::type_index, std::unique_ptr<branchClass>>;
+
+    // 对冲执行的共享状态：两份副本中先完成者写入 promise（可调用对象由各副本自带，不在此共享）
+    template <typename R>
+    struct hedgeState {
+        std::promise<R> task_promise;
+        std::atomic<bool> done = {false};
+
+        void run(std::function<R()> &exec) {
+            if (done.load()) return; // 另一份已完成：本副本作废
+            try {
+                std::promise<R> local;
+                auto res = local.get_future();
+                details::fulfil(local, exec);
+                if (!done.exchange(true)) forward_result(res);
+            } catch (...) {
+                if (!done.exchange(true)) task_promise.set_exception(std::current_exception());
+            }
+        }
+
+        template <typename U>
+        void forward_result(std::future<U> &res) {
+            task_promise.set_value(res.get());
+        }
+
+        void forward_result(std::future<void> &res) {
+            res.get();
+            task_promise.set_value();
+        }
+    };
+
+    static constexpr std::chrono::microseconds hedge_fallback = std::chrono::microseconds(1000);
+
+    // 对冲使用的定时器（首次使用时创建）
+    details::timer &hedge_timer() {
+        if (!m_timer) m_timer.reset(new details::timer());
+        return *m_timer;
+    }
 
     // 实际的容器（unique_ptr 表示 workspace 独占所有权）
     workbranchList m_branchList;
+    size_t m_routeSamples = 2; // 路由采样的分支数 d
     supervisorMap m_superMap;
+    remoteList m_remoteList;       // 进程外分支
+    remoteList::iterator rcur = {}; // 进程外分支的轮询游标
+    details::singleflight m_flights; // submit_once 的在途 key 表
+    details::hashRing<workbranch *> m_branchRing; // submit_keyed 的分支哈希环（只含未分类的分支）
+    double m_keyedBalance = 1.25;                 // 分支层负载上限系数
+    std::unique_ptr<details::timer> m_timer;
+    classMap m_classes; // 分支类别（含未分类）
 
 private:
+    // 取类别（不存在时创建）
+    branchClass &group(const std::type_info &cls) {
+        auto &slot = m_classes[std::type_index(cls)];
+        if (!slot) slot.reset(new branchClass());
+        return *slot;
+    }
+
+    // 未分类分支中路由（不带类别的 submit 系列）
+    workbranch *route(workbranch **runner_up = nullptr) {
+        return route(group(typeid(void)).branches, runner_up);
+    }
+
     /**
-     * @brief forward - 将迭代器前进一位（环回至 begin）
-     * @param this_pos - 要前进的迭代器（会被修改）
-     * @return 返回修改后的迭代器的引用
+     * @brief route - 从 pool 中随机采样 d 个分支（power of d choices），返回预期时延最小者
+     * @param runner_up 非空时写入另一个分支（采样中的次优者，必要时取相邻分支），只有一个分支时与返回值相同
      *
-     * 注意：调用者必须确保容器非空才调用本函数（submit 中有断言保证）。
+     * 预期时延由 workbranch::expected_delay() 从分支的无锁负载信号计算，已计入各分支的 worker 数与平均执行耗时，
+     * 因此规模或任务粒度不同的分支也可直接比较。pool 为空时抛出 std::runtime_error。
      */
-    const pos_t &forward(pos_t &this_pos) {
-        if (++this_pos == m_branchList.end()) this_pos = m_branchList.begin();
-        return this_pos;
+    workbranch *route(const std::vector<workbranch *> &pool, workbranch **runner_up = nullptr) {
+        if (pool.empty()) throw std::runtime_error("workspace: no branch attached for this class");
+        size_t n = pool.size();
+        bool all = m_routeSamples >= n;
+        size_t d = all ? n : m_routeSamples;
+        size_t best = n, second = n;
+        double best_delay = 0, second_delay = 0;
+        for (size_t i = 0; i < d; ++i) {
+            size_t idx = all ? i : sample_index(n);
+            if (idx == best || idx == second) continue;
+            double delay = pool[idx]->expected_delay();
+            if (best == n || delay < best_delay) {
+                second = best;
+                second_delay = best_delay;
+                best = idx;
+                best_delay = delay;
+            } else if (second == n || delay < second_delay) {
+                second = idx;
+                second_delay = delay;
+            }
+        }
+        if (runner_up) *runner_up = pool[second != n ? second : (best + 1) % n];
+        return pool[best];
+    }
+
+    // 线程局部的 splitmix64 序列：路由采样不共享随机数状态
+    static size_t sample_index(size_t n) {
+        static thread_local uint64_t state = reinterpret_cast<uintptr_t>(&state);
+        state = details::mix64(state);
+        return static_cast<size_t>(state % n);
     }
 };
 
@@ -0,0 +1 @@
+#include "libs/actor.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "libs/admission.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "libs/asyncsync.h"
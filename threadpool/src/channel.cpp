@@ -0,0 +1 @@
+#include "libs/channel.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "libs/coalescer.h"
\ No newline at end of file
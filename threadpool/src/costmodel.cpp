@@ -0,0 +1 @@
+#include "libs/costmodel.h"
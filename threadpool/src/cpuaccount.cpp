@@ -0,0 +1 @@
+#include "libs/cpuaccount.h"
\ No newline at end of file
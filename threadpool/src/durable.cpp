@@ -0,0 +1 @@
+#include "libs/durable.h"
\ No newline at end of file
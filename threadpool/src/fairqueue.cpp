@@ -0,0 +1 @@
+#include "libs/fairqueue.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "libs/hashring.h"
@@ -0,0 +1 @@
+#include "libs/metrics.h"
\ No newline at end of file
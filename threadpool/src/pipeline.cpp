@@ -0,0 +1 @@
+#include "libs/pipeline.h"
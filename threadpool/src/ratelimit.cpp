@@ -0,0 +1 @@
+#include "libs/ratelimit.h"
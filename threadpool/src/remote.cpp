@@ -0,0 +1 @@
+#include "libs/remote.h"
\ No newline at end of file
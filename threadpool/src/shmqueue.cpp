@@ -0,0 +1 @@
+#include "libs/shmqueue.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "libs/singleflight.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "libs/timer.h"
\ No newline at end of file
@@ -0,0 +1 @@
+#include "libs/tokenbucket.h"
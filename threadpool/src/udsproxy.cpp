@@ -0,0 +1 @@
+#include "libs/udsproxy.h"
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+
+// 测试用断言：与 assert 不同，不受 NDEBUG 影响，失败时打印位置并以非零码退出
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#define CHECK(cond)                                                                       \
+    do {                                                                                  \
+        if (!(cond)) {                                                                    \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            std::exit(1);                                                                 \
+        }                                                                                 \
+    } while (0)
+
+// 从 start 到现在经过的毫秒数
+inline long long elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,122 @@
+// actor：消息串行执行；ask 返回结果与异常；未处理完的 actor 重新排到队尾，不占用 LIFO next 槽；
+// 分支 abort 或关闭后邮箱被清空而不是卡住
+#include "check.h"
+#include "libs/actor.h"
+#include <atomic>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace sunshine;
+using sunshine::details::workbranch;
+
+struct counter {
+    int value = 0;
+    std::atomic<int> inside = {0};
+    bool overlapped = false;
+};
+
+int main() {
+    // 多个发送线程、4 个 worker：同一 actor 的消息从不并发执行，也不丢失
+    {
+        workbranch wb(4);
+        std::vector<std::unique_ptr<actor<counter>>> actors;
+        for (int i = 0; i < 8; ++i) actors.emplace_back(new actor<counter>(wb, 4));
+        std::vector<std::thread> senders;
+        for (int t = 0; t < 4; ++t) {
+            senders.emplace_back([&actors] {
+                for (int i = 0; i < 5000; ++i) {
+                    actors[i % actors.size()]->tell([](counter &c) {
+                        if (c.inside.fetch_add(1) != 0) c.overlapped = true;
+                        ++c.value;
+                        c.inside.fetch_sub(1);
+                    });
+                }
+            });
+        }
+        for (auto &t : senders) t.join();
+        for (auto &a : actors) {
+            CHECK(a->ask([](counter &c) { return c.value; }).get() == 2500);
+            CHECK(!a->ask([](counter &c) { return c.overlapped; }).get());
+        }
+        wb.wait_tasks(5000);
+        for (auto &a : actors) CHECK(a->idle());
+    }
+
+    // ask：按发送顺序执行，异常经 future 传回
+    {
+        workbranch wb(2);
+        actor<counter> a(wb);
+        std::vector<std::future<int>> futs;
+        for (int i = 0; i < 100; ++i) futs.push_back(a.ask([](counter &c) { return ++c.value; }));
+        for (int i = 0; i < 100; ++i) CHECK(futs[i].get() == i + 1);
+        bool threw = false;
+        try {
+            a.ask([](counter &) -> int { throw std::runtime_error("boom"); }).get();
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        CHECK(threw);
+        wb.wait_tasks(5000);
+    }
+
+    // 开启 LIFO：batch = 1 的 actor 处理一条后排到队尾，之前排队的任务紧接着执行
+    {
+        workbranch wb(1);
+        wb.enable_lifo(true);
+        actor<counter> a(wb, 1);
+        std::atomic<bool> release = {false};
+        std::atomic<int> processed = {0};
+        wb.submit([&release] {
+            while (!release.load()) std::this_thread::yield();
+        });
+        for (int i = 0; i < 100; ++i) a.tell([&processed](counter &) { ++processed; });
+        std::atomic<int> seen = {-1};
+        wb.submit([&processed, &seen] { seen = processed.load(); });
+        release = true;
+        wb.wait_tasks(5000);
+        CHECK(seen.load() == 1);
+        CHECK(processed.load() == 100);
+    }
+
+    // 调度被 abort 取消：排队的消息被丢弃（ask 的 future 失败），actor 回到空闲；关闭后的 tell 向发送者抛出
+    {
+        workbranch wb(1);
+        actor<counter> a(wb);
+        std::promise<void> gate;
+        std::shared_future<void> open = gate.get_future().share();
+        wb.submit([open] { open.wait(); });
+        std::atomic<int> processed = {0};
+        for (int i = 0; i < 10; ++i) a.tell([&processed](counter &) { ++processed; });
+        auto answer = a.ask([](counter &c) { return c.value; });
+        CHECK(!a.idle());
+        std::thread closer([&wb] { wb.shutdown(shutdownMode::abort); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        gate.set_value();
+        closer.join();
+        CHECK(answer.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+        bool failed = false;
+        try {
+            answer.get();
+        } catch (const std::future_error &) {
+            failed = true;
+        }
+        CHECK(failed);
+        CHECK(processed.load() == 0);
+        CHECK(a.idle());
+        for (int i = 0; i < 2; ++i) {
+            bool threw = false;
+            try {
+                a.tell([&processed](counter &) { ++processed; });
+            } catch (const std::runtime_error &) {
+                threw = true;
+            }
+            CHECK(threw);
+            CHECK(a.idle());
+        }
+        CHECK(processed.load() == 0);
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+// adaptive 等待策略：任务密集时放开自旋预算，间隔长时收回；空闲的分支挂起而不空转，挂起后仍能及时唤醒
+#include "check.h"
+#include "libs/workbranch.h"
+#include <atomic>
+#include <ctime>
+#include <thread>
+
+using namespace sunshine;
+using namespace sunshine::details;
+
+int main() {
+    using clock = adaptiveSpin::clock;
+    using ns = std::chrono::nanoseconds;
+
+    // 任务间隔短（10us）且忙碌比例高：预算接近上限
+    {
+        adaptiveSpin spin(10000);
+        CHECK(spin.budget() == 0);
+        auto t = clock::now();
+        for (int i = 0; i < 100; ++i) {
+            spin.on_idle(t);
+            t += ns(10000);
+            spin.on_task(t);
+            t += ns(90000);
+        }
+        CHECK(spin.budget() > 8000);
+    }
+
+    // 任务间隔长（10ms）：预算收缩到接近 0
+    {
+        adaptiveSpin spin(10000);
+        auto t = clock::now();
+        for (int i = 0; i < 100; ++i) {
+            spin.on_idle(t);
+            t += ns(10000000);
+            spin.on_task(t);
+            t += ns(10000);
+        }
+        CHECK(spin.budget() < 100);
+    }
+
+    // 分支：一阵密集任务之后空闲，worker 挂起而不占 CPU；再次提交时立即被唤醒
+    {
+        workbranch wb(4, waitStrategy::adaptive);
+        std::atomic<int> done = {0};
+        for (int i = 0; i < 20000; ++i) wb.submit([&done] { ++done; });
+        CHECK(wb.wait_tasks(5000));
+        CHECK(done.load() == 20000);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::clock_t cpu_start = std::clock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        double cpu_ms = 1000.0 * static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+        CHECK(cpu_ms < 100);
+
+        auto start = std::chrono::steady_clock::now();
+        wb.submit([] { return 1; }).get();
+        CHECK(elapsed_ms(start) < 100);
+    }
+    return 0;
+}
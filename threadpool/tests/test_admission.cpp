@@ -0,0 +1,47 @@
+// workspace::submit<task::shed>：经所选分支的准入控制，预测排队时间超过 SLO 时拒绝
+#include "check.h"
+#include "libs/workspace.h"
+#include <atomic>
+#include <thread>
+
+using namespace sunshine;
+
+int main() {
+    std::atomic<bool> gate = {false};
+    workspace ws;
+    auto id = ws.attach(new workbranch(1));
+    workbranch &wb = ws[id];
+    wb.enable_admission(true);
+
+    // 先积累执行耗时样本（约 5ms / 任务）
+    for (int i = 0; i < 4; ++i) wb.submit([] { std::this_thread::sleep_for(std::chrono::milliseconds(5)); });
+    wb.wait_tasks();
+
+    // 占住唯一的 worker 并积压 20 个任务：预测排队时间约 100ms
+    wb.submit([&gate] {
+        while (!gate.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    });
+    for (int i = 0; i < 20; ++i) wb.submit([] { std::this_thread::sleep_for(std::chrono::milliseconds(5)); });
+
+    bool accepted = ws.submit<task::shed>([] {}, std::chrono::milliseconds(10));
+    CHECK(!accepted);
+    auto fut = ws.submit<task::shed>([] { return 1; }, std::chrono::milliseconds(10));
+    bool rejected = false;
+    try {
+        fut.get();
+    } catch (const task_rejected &) {
+        rejected = true;
+    }
+    CHECK(rejected);
+    CHECK(wb.num_rejected() >= 2);
+
+    // SLO 足够宽松时接受
+    std::atomic<int> ran = {0};
+    CHECK(ws.submit<task::shed>([&ran] { ++ran; }, std::chrono::seconds(10)));
+    auto ok = ws.submit<task::shed>([] { return 7; }, std::chrono::seconds(10));
+    gate = true;
+    CHECK(ok.get() == 7);
+    wb.wait_tasks();
+    CHECK(ran.load() == 1);
+    return 0;
+}
@@ -0,0 +1,121 @@
+// async_mutex / async_semaphore / latch / barrier：等待者以续延排队而不阻塞 worker
+#include "check.h"
+#include "libs/asyncsync.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+
+using namespace sunshine;
+using sunshine::details::workbranch;
+
+int main() {
+    // 互斥：10000 个任务在 4 个 worker 上争用，临界区互不重叠
+    {
+        workbranch wb(4);
+        async_mutex m;
+        int counter = 0;
+        std::atomic<int> inside = {0};
+        std::atomic<bool> overlapped = {false};
+        for (int i = 0; i < 10000; ++i) {
+            wb.submit([&] {
+                m.with_lock(wb, [&] {
+                    if (inside.fetch_add(1) != 0) overlapped = true;
+                    ++counter;
+                    inside.fetch_sub(1);
+                });
+            });
+        }
+        CHECK(wb.wait_tasks(10000));
+        CHECK(counter == 10000);
+        CHECK(!overlapped.load());
+        CHECK(m.try_lock());
+        m.unlock();
+    }
+
+    // 单个 worker：等锁的任务不占住 worker，后续任务照常执行，解锁后续延才执行
+    {
+        workbranch wb(1);
+        async_mutex m;
+        CHECK(m.try_lock());
+        std::atomic<bool> got = {false}, other = {false};
+        wb.submit([&] { m.lock(wb, [&] { got = true; }); });
+        wb.submit([&] { other = true; });
+        CHECK(wb.wait_tasks(5000));
+        CHECK(other.load());
+        CHECK(!got.load());
+        m.unlock();
+        CHECK(wb.wait_tasks(5000));
+        CHECK(got.load());
+        m.unlock();
+    }
+
+    // 信号量：最多 2 个任务同时持有许可
+    {
+        workbranch wb(8);
+        async_semaphore sem(2);
+        std::atomic<int> holders = {0}, peak = {0}, done = {0};
+        for (int i = 0; i < 100; ++i) {
+            wb.submit([&] {
+                sem.acquire(wb, [&] {
+                    int now = ++holders;
+                    int seen = peak.load();
+                    while (now > seen && !peak.compare_exchange_weak(seen, now)) {
+                    }
+                    std::this_thread::sleep_for(std::chrono::microseconds(200));
+                    --holders;
+                    ++done;
+                    sem.release();
+                });
+            });
+        }
+        CHECK(wb.wait_tasks(10000));
+        CHECK(done.load() == 100);
+        CHECK(peak.load() <= 2);
+        CHECK(sem.try_acquire() && sem.try_acquire() && !sem.try_acquire());
+    }
+
+    // latch：计数归零后才放行等待者
+    {
+        workbranch wb(2);
+        latch l(3);
+        std::atomic<bool> released = {false};
+        l.wait(wb, [&] { released = true; });
+        l.count_down();
+        l.count_down();
+        CHECK(wb.wait_tasks(5000));
+        CHECK(!released.load());
+        CHECK(!l.try_wait());
+        l.count_down();
+        CHECK(wb.wait_tasks(5000));
+        CHECK(released.load());
+        CHECK(l.try_wait());
+    }
+
+    // barrier：3 个参与者走 5 个阶段，每阶段 completion 恰好执行一次且在放行之前
+    {
+        workbranch wb(2);
+        std::atomic<int> completions = {0};
+        std::atomic<int> arrivals = {0};
+        std::atomic<bool> early = {false};
+        barrier b(3, [&] { ++completions; });
+        std::function<void(int)> step;
+        step = [&](int phase) {
+            if (phase == 5) return;
+            ++arrivals;
+            b.arrive_and_wait(wb, [&, phase] {
+                if (completions.load() < phase + 1) early = true;
+                step(phase + 1);
+            });
+        };
+        for (int i = 0; i < 3; ++i) wb.submit([&] { step(0); });
+        auto start = std::chrono::steady_clock::now();
+        while (b.phase() < 5 && elapsed_ms(start) < 5000) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        CHECK(wb.wait_tasks(5000));
+        CHECK(b.phase() == 5);
+        CHECK(completions.load() == 5);
+        CHECK(arrivals.load() == 15);
+        CHECK(!early.load());
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+// background：只在前台队列全空时执行，不计入 num_tasks()；挂起的 worker 同样会被后台任务唤醒
+#include "check.h"
+#include "libs/workbranch.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using namespace sunshine;
+using namespace sunshine::details;
+
+int main() {
+    // 先提交的后台任务让位于后提交的前台任务
+    {
+        workbranch wb(1);
+        std::atomic<bool> release = {false};
+        std::mutex mtx;
+        std::string order;
+        auto log = [&mtx, &order](char c) {
+            std::lock_guard<std::mutex> lock(mtx);
+            order += c;
+        };
+        wb.submit([&release] {
+            while (!release.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        for (int i = 0; i < 3; ++i) wb.submit<background>([&log] { log('b'); });
+        for (int i = 0; i < 3; ++i) wb.submit([&log] { log('f'); });
+        CHECK(wb.num_background() == 3);
+        CHECK(wb.num_tasks() == 3);
+        release = true;
+        CHECK(wb.wait_tasks(5000));
+        CHECK(order == "fffbbb");
+        CHECK(wb.num_background() == 0);
+    }
+
+    // blocking 策略：空闲分支上的后台任务唤醒挂起的 worker；返回值版本经 future 返回结果
+    {
+        workbranch wb(2, waitStrategy::blocking);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        auto fut = wb.submit<background>([] { return 7; });
+        CHECK(fut.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+        CHECK(fut.get() == 7);
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+// broadcast / submit_keyed：worker 在 add_worker 返回时即已登记，刚启动的 worker 不会被漏掉
+#include "check.h"
+#include "libs/workbranch.h"
+#include <future>
+#include <mutex>
+#include <set>
+#include <thread>
+
+using namespace sunshine;
+using namespace sunshine::details;
+
+int main() {
+    // 构造后立即 broadcast：每个 worker 恰好执行一次
+    for (int round = 0; round < 50; ++round) {
+        workbranch wb(4);
+        std::mutex mtx;
+        std::multiset<std::thread::id> ran;
+        auto record = [&mtx, &ran] {
+            std::lock_guard<std::mutex> lock(mtx);
+            ran.insert(std::this_thread::get_id());
+        };
+        wb.broadcast(record).get();
+        CHECK(ran.size() == 4);
+        CHECK(std::set<std::thread::id>(ran.begin(), ran.end()).size() == 4);
+
+        // add_worker 之后立即 broadcast：新 worker 同样收到
+        wb.add_worker();
+        ran.clear();
+        wb.broadcast(record).get();
+        CHECK(ran.size() == 5);
+        CHECK(std::set<std::thread::id>(ran.begin(), ran.end()).size() == 5);
+    }
+
+    // 构造后立即 submit_keyed：同一个 key 始终落在同一个 worker 上（逐个等待，不触发过载溢出）
+    for (int round = 0; round < 20; ++round) {
+        workbranch wb(4);
+        std::set<std::thread::id> seen;
+        for (int i = 0; i < 20; ++i) {
+            seen.insert(wb.submit_keyed(42, [] { return std::this_thread::get_id(); }).get());
+        }
+        CHECK(seen.size() == 1);
+    }
+    return 0;
+}
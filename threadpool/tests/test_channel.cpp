@@ -0,0 +1,110 @@
+// channel / selector：回调式生产者-消费者按序传递且不占线程；close 唤醒等待者；select 恰好完成一个分支
+#include "check.h"
+#include "libs/channel.h"
+#include <atomic>
+#include <functional>
+#include <future>
+#include <optional>
+#include <thread>
+
+using namespace sunshine;
+using sunshine::details::workbranch;
+
+int main() {
+    // 有界通道上的生产者 / 消费者：100k 个元素按序到达（2 个 worker，等待期间不阻塞线程）
+    {
+        workbranch wb(2);
+        channel<int> ch(4);
+        const int total = 100000;
+        std::promise<void> finished;
+        long long sum = 0;
+        bool ordered = true;
+        int expect = 0;
+
+        std::function<void(int)> produce = [&](int i) {
+            if (i == total) {
+                ch.close();
+                return;
+            }
+            ch.send(wb, i, [&, i](bool ok) {
+                CHECK(ok);
+                produce(i + 1);
+            });
+        };
+        std::function<void()> consume = [&] {
+            ch.recv(wb, [&](std::optional<int> v) {
+                if (!v) {
+                    finished.set_value();
+                    return;
+                }
+                if (*v != expect) ordered = false;
+                ++expect;
+                sum += *v;
+                consume();
+            });
+        };
+        consume();
+        produce(0);
+        CHECK(finished.get_future().wait_for(std::chrono::seconds(30)) == std::future_status::ready);
+        CHECK(ordered);
+        CHECK(expect == total);
+        CHECK(sum == static_cast<long long>(total) * (total - 1) / 2);
+        wb.wait_tasks(5000);
+    }
+
+    // close 唤醒挂起的接收方与发送方
+    {
+        workbranch wb(1);
+        channel<int> ch(1);
+        CHECK(ch.try_send(1));
+        CHECK(!ch.try_send(2));
+        std::promise<bool> sent;
+        ch.send(wb, 2, [&sent](bool ok) { sent.set_value(ok); });
+        CHECK(ch.try_recv() == 1);
+        CHECK(sent.get_future().get());
+        CHECK(ch.try_recv() == 2);
+
+        std::promise<bool> got;
+        ch.recv(wb, [&got](std::optional<int> v) { got.set_value(v.has_value()); });
+        ch.close();
+        CHECK(!got.get_future().get());
+        CHECK(!ch.try_send(3));
+    }
+
+    // select：两个通道都就绪时轮流选择；都未就绪时挂起，只有先就绪的分支完成
+    {
+        workbranch wb(2);
+        channel<int> a, b;
+        std::atomic<int> from_a = {0}, from_b = {0};
+        for (int i = 0; i < 200; ++i) {
+            CHECK(a.try_send(i));
+            CHECK(b.try_send(i));
+        }
+        for (int i = 0; i < 200; ++i) {
+            std::promise<void> done;
+            selector(wb)
+                .on_recv(a, [&](std::optional<int>) { ++from_a; done.set_value(); })
+                .on_recv(b, [&](std::optional<int>) { ++from_b; done.set_value(); })
+                .run();
+            done.get_future().get();
+        }
+        CHECK(from_a.load() + from_b.load() == 200);
+        CHECK(from_a.load() > 0 && from_b.load() > 0);
+        CHECK(a.size() + b.size() == 200);
+
+        channel<int> c, d;
+        std::promise<int> winner;
+        selector(wb)
+            .on_recv(c, [&winner](std::optional<int> v) { winner.set_value(*v); })
+            .on_recv(d, [&winner](std::optional<int> v) { winner.set_value(100 + *v); })
+            .run();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        CHECK(d.try_send(7));
+        CHECK(winner.get_future().get() == 107);
+        // 已完成的 select 不再从 c 取元素
+        CHECK(c.try_send(1));
+        wb.wait_tasks(5000);
+        CHECK(c.size() == 1);
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+// 分支类别：attach<cls> 接管的分支只接收 submit<cls>，不带类别的提交只在未分类的分支间路由
+#include "check.h"
+#include "libs/workspace.h"
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace sunshine;
+
+struct gpu : branch_class {};
+
+// 收集分支当前所有 worker 的线程 id
+static std::set<std::thread::id> threads_of(workbranch *br) {
+    std::set<std::thread::id> ids;
+    std::mutex mtx;
+    auto done = br->broadcast([&] {
+        std::lock_guard<std::mutex> lock(mtx);
+        ids.insert(std::this_thread::get_id());
+    });
+    done.get();
+    return ids;
+}
+
+int main() {
+    workspace spc;
+    auto io1 = new workbranch(2);
+    auto io2 = new workbranch(2);
+    auto cpu = new workbranch(1);
+    auto plain = new workbranch(1);
+    auto io1_id = spc.attach<pool::io>(io1);
+    spc.attach<pool::io>(io2);
+    spc.attach<pool::cpu>(cpu);
+    spc.attach(plain);
+
+    auto io_threads = threads_of(io1);
+    auto io2_threads = threads_of(io2);
+    io_threads.insert(io2_threads.begin(), io2_threads.end());
+    auto cpu_threads = threads_of(cpu);
+    auto plain_threads = threads_of(plain);
+    CHECK(io_threads.size() == 4 && cpu_threads.size() == 1 && plain_threads.size() == 1);
+
+    auto here = [] { return std::this_thread::get_id(); };
+    for (int i = 0; i < 50; ++i) {
+        CHECK(io_threads.count(spc.submit<pool::io>(here).get()) == 1);
+        CHECK(cpu_threads.count(spc.submit<pool::cpu, task::urg>(here).get()) == 1);
+        CHECK(plain_threads.count(spc.submit(here).get()) == 1);
+    }
+
+    // 类别与任务类型组合：seq 在同一类别的某个分支上按顺序执行
+    {
+        std::vector<int> order;
+        std::mutex mtx;
+        std::set<std::thread::id> ran;
+        auto step = [&](int n) {
+            return [&, n] {
+                std::lock_guard<std::mutex> lock(mtx);
+                order.push_back(n);
+                ran.insert(std::this_thread::get_id());
+            };
+        };
+        spc.submit<pool::io, task::seq>(step(1), step(2), step(3));
+        CHECK(io1->wait_tasks(5000) && io2->wait_tasks(5000));
+        CHECK((order == std::vector<int>{1, 2, 3}));
+        CHECK(ran.size() == 1 && io_threads.count(*ran.begin()) == 1);
+    }
+
+    // 汇总指标
+    {
+        auto io = spc.class_stats<pool::io>();
+        CHECK(io.branches == 2 && io.workers == 4);
+        CHECK(io.submitted == 51);
+        auto c = spc.class_stats<pool::cpu>();
+        CHECK(c.branches == 1 && c.workers == 1 && c.submitted == 50);
+        auto none = spc.class_stats<void>();
+        CHECK(none.branches == 1 && none.workers == 1);
+        auto g = spc.class_stats<gpu>();
+        CHECK(g.branches == 0 && g.submitted == 0);
+    }
+
+    // 没有分支的类别：提交抛出 std::runtime_error
+    {
+        bool threw = false;
+        try {
+            spc.submit<gpu>([] {});
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+
+    // detach 后分支从类别中移除，其余同类分支继续接收
+    {
+        auto owned = spc.detach(io1_id);
+        CHECK(owned.get() == io1);
+        CHECK(spc.class_stats<pool::io>().branches == 1);
+        for (int i = 0; i < 20; ++i) CHECK(io2_threads.count(spc.submit<pool::io>(here).get()) == 1);
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+// coalescer：按 chunk 与 linger 合批提交；分支 shutdown 后析构不会抛出
+#include "check.h"
+#include "libs/coalescer.h"
+#include <atomic>
+#include <thread>
+
+using namespace sunshine;
+using namespace sunshine::details;
+
+int main() {
+    // 满 chunk 时提交，剩余部分由析构 flush
+    {
+        std::atomic<int> n = {0};
+        workbranch wb(4);
+        {
+            coalescer co(wb, 16);
+            for (int i = 0; i < 1000; ++i) co.submit([&n] { ++n; });
+            CHECK(co.buffered() == 1000 % 16);
+        }
+        wb.wait_tasks();
+        CHECK(n.load() == 1000);
+    }
+
+    // linger 到期后由定时器 flush
+    {
+        std::atomic<int> n = {0};
+        timer tm;
+        workbranch wb(2);
+        coalescer co(wb, 64, std::chrono::microseconds(2000), &tm);
+        for (int i = 0; i < 10; ++i) co.submit([&n] { ++n; });
+        auto start = std::chrono::steady_clock::now();
+        while (n.load() < 10 && elapsed_ms(start) < 5000) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        CHECK(n.load() == 10);
+        CHECK(co.buffered() == 0);
+    }
+
+    // 分支已关闭：显式 flush 抛出，析构时吞掉异常并丢弃缓冲的任务
+    {
+        workbranch wb(1);
+        wb.shutdown(shutdownMode::abort);
+        bool threw = false;
+        {
+            coalescer co(wb, 8);
+            co.submit([] {});
+            try {
+                co.flush();
+            } catch (const std::runtime_error &) {
+                threw = true;
+            }
+            co.submit([] {});
+        }
+        CHECK(threw);
+    }
+    return 0;
+}
@@ -0,0 +1,136 @@
+// submit_costed：预估耗时计入分支的未完成工作量，tag 提示按历史耗时学习，路由按工作量比较
+#include "check.h"
+#include "libs/workspace.h"
+#include <atomic>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sunshine;
+using namespace sunshine::details;
+
+template <typename P>
+static bool eventually(P &&pred) {
+    auto start = std::chrono::steady_clock::now();
+    while (!pred()) {
+        if (elapsed_ms(start) > 5000) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+int main() {
+    // costTable：EWMA 系数 1/4，各 tag 独立，表满后新 tag 不再记录
+    {
+        costTable table;
+        const char *a = "a";
+        const char *b = "b";
+        CHECK(table.estimate(a) == 0);
+        table.learn(a, std::chrono::nanoseconds(1000));
+        CHECK(table.estimate(a) == 1000);
+        table.learn(a, std::chrono::nanoseconds(2000));
+        CHECK(table.estimate(a) == 1250);
+        CHECK(table.estimate(b) == 0);
+        std::vector<std::string> names;
+        for (size_t i = 0; i < costTable::slots + 8; ++i) names.push_back("tag" + std::to_string(i));
+        for (auto &n : names) table.learn(n.c_str(), std::chrono::nanoseconds(500));
+        CHECK(table.estimate(a) == 1250);
+        size_t kept = 0;
+        for (auto &n : names) kept += table.estimate(n.c_str()) == 500;
+        CHECK(kept == costTable::slots - 1);
+    }
+
+    // 显式耗时：排队期间计入工作量与预期时延，执行后扣除
+    {
+        workbranch wb(1);
+        std::promise<void> gate;
+        std::shared_future<void> open = gate.get_future().share();
+        wb.submit([open] { open.wait(); });
+        CHECK(eventually([&] { return wb.load_signal().active.load() == 1; }));
+        double before = wb.expected_delay();
+        auto fut = wb.submit_costed(std::chrono::milliseconds(50), [] { return 7; });
+        CHECK(wb.load_signal().work_ns.load() == 50000000);
+        CHECK(wb.load_signal().costed.load() == 1);
+        CHECK(wb.expected_delay() >= before + 5e7);
+        gate.set_value();
+        CHECK(fut.get() == 7);
+        CHECK(wb.wait_tasks(5000));
+        CHECK(wb.load_signal().work_ns.load() == 0);
+        CHECK(wb.load_signal().costed.load() == 0);
+    }
+
+    // tag 提示：执行时打上该 tag 并学习耗时，之后的同 tag 任务按学到的耗时计入工作量
+    {
+        workbranch wb(1);
+        CHECK(wb.learned_cost("sleep").count() == 0);
+        std::atomic<bool> tagged_ok = {true};
+        for (int i = 0; i < 5; ++i) {
+            wb.submit_costed("sleep", [&] {
+                const char *t = current_task_tag().load();
+                if (!t || std::string(t) != "sleep") tagged_ok = false;
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            });
+        }
+        CHECK(wb.wait_tasks(5000));
+        CHECK(tagged_ok.load());
+        CHECK(wb.learned_cost("sleep") >= std::chrono::milliseconds(1));
+
+        std::promise<void> gate;
+        std::shared_future<void> open = gate.get_future().share();
+        wb.submit([open] { open.wait(); });
+        wb.submit_costed("sleep", [] {});
+        CHECK(wb.load_signal().work_ns.load() == static_cast<uint64_t>(wb.learned_cost("sleep").count()));
+        gate.set_value();
+        CHECK(wb.wait_tasks(5000));
+        CHECK(wb.load_signal().work_ns.load() == 0);
+    }
+
+    // 被 shutdown 取消的任务同样扣除工作量
+    {
+        workbranch wb(1);
+        std::promise<void> gate;
+        std::shared_future<void> open = gate.get_future().share();
+        wb.submit([open] { open.wait(); });
+        CHECK(eventually([&] { return wb.load_signal().active.load() == 1; }));
+        std::vector<std::future<int>> futs;
+        for (int i = 0; i < 10; ++i) futs.push_back(wb.submit_costed(std::chrono::milliseconds(10), [] { return 1; }));
+        CHECK(wb.load_signal().costed.load() == 10);
+        std::thread closer([&] { wb.shutdown(shutdownMode::abort); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        gate.set_value();
+        closer.join();
+        for (auto &f : futs) {
+            bool cancelled = false;
+            try {
+                f.get();
+            } catch (const task_cancelled &) {
+                cancelled = true;
+            }
+            CHECK(cancelled);
+        }
+        CHECK(wb.load_signal().work_ns.load() == 0);
+        CHECK(wb.load_signal().costed.load() == 0);
+    }
+
+    // workspace：昂贵任务所在分支的预期时延按工作量计算，后续提交避开它
+    {
+        workspace spc;
+        auto heavy = new workbranch(1);
+        auto light = new workbranch(1);
+        spc.attach(heavy);
+        spc.attach(light);
+        std::promise<void> gate;
+        std::shared_future<void> open = gate.get_future().share();
+        heavy->submit_costed(std::chrono::seconds(1), [open] { open.wait(); });
+        CHECK(eventually([&] { return heavy->load_signal().active.load() == 1; }));
+        // 若被路由到 heavy，任务要等 gate 打开才执行
+        for (int i = 0; i < 50; ++i) {
+            auto fut = spc.submit([] { return 1; });
+            CHECK(fut.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+        }
+        gate.set_value();
+        CHECK(heavy->wait_tasks(5000));
+    }
+    return 0;
+}
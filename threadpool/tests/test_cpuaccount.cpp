@@ -0,0 +1,121 @@
+// cpuAccount：多线程记账按分片合并后不丢计数；按 tag 指针记账不分配内存、读取时按内容合并；
+// 配额窗口无锁判定，并发设置配额时读取方不会崩溃
+#include "check.h"
+#include "libs/workbranch.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+#include <vector>
+
+using namespace sunshine;
+using namespace sunshine::details;
+
+// 统计本进程的堆分配次数
+static std::atomic<size_t> allocations = {0};
+
+void *operator new(std::size_t n) {
+    ++allocations;
+    if (void *p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+int main() {
+    using ms = std::chrono::milliseconds;
+    auto now = cpuAccount::clock::now();
+
+    // 多个线程同时记账，合并结果与逐笔相加一致
+    {
+        cpuAccount acct;
+        const int threads = 24, per = 20000;
+        std::vector<std::thread> ts;
+        for (int t = 0; t < threads; ++t) {
+            ts.emplace_back([&acct, t, now] {
+                cpuAccount::tenant_t tenant = static_cast<cpuAccount::tenant_t>(t % 3);
+                for (int i = 0; i < per; ++i) acct.record("io", &tenant, std::chrono::nanoseconds(10), now);
+            });
+        }
+        for (auto &t : ts) t.join();
+        CHECK(acct.tag_usage("io").tasks == static_cast<uint64_t>(threads) * per);
+        CHECK(acct.tag_usage("io").cpu == std::chrono::nanoseconds(10LL * threads * per));
+        CHECK(acct.tenant_usage(0).tasks + acct.tenant_usage(1).tasks + acct.tenant_usage(2).tasks ==
+              static_cast<uint64_t>(threads) * per);
+        CHECK(acct.tag_usage("cpu").tasks == 0);
+    }
+
+    // tag 按指针记账：已出现过的 tag 再次记账不分配内存（tag 超出短字符串优化的长度）；内容相同、地址不同的 tag 读取时合并
+    {
+        cpuAccount acct;
+        char first[] = "render-thumbnail-batch";
+        char second[] = "render-thumbnail-batch";
+        cpuAccount::tenant_t tenant = 7;
+        acct.record(first, &tenant, std::chrono::nanoseconds(5), now);
+        size_t before = allocations.load();
+        for (int i = 0; i < 10000; ++i) acct.record(first, &tenant, std::chrono::nanoseconds(5), now);
+        CHECK(allocations.load() == before);
+        acct.record(second, nullptr, std::chrono::nanoseconds(5), now);
+        CHECK(acct.tag_usage("render-thumbnail-batch").tasks == 10002);
+        CHECK(acct.tag_usage("render-thumbnail-batch").cpu == std::chrono::nanoseconds(5 * 10002));
+        CHECK(acct.tenant_usage(tenant).tasks == 10001);
+    }
+
+    // 配额：窗口 100ms、0.5 核 => 预算 50ms
+    {
+        cpuAccount acct;
+        cpuAccount::tenant_t a = 1, b = 2;
+        CHECK(!acct.any_quota());
+        acct.set_quota(a, 0.5, ms(100));
+        CHECK(acct.any_quota());
+        acct.record(nullptr, &a, ms(40), now);
+        CHECK(!acct.over_quota(a, now));
+        acct.record(nullptr, &a, ms(20), now);
+        CHECK(acct.over_quota(a, now));
+        acct.record(nullptr, &b, ms(500), now);
+        CHECK(!acct.over_quota(b, now));
+        // 窗口滑过之后恢复
+        CHECK(!acct.over_quota(a, now + ms(300)));
+        // 取消配额
+        acct.set_quota(a, 0, ms(100));
+        CHECK(!acct.any_quota());
+        CHECK(!acct.over_quota(a, now));
+    }
+
+    // 记账 / 判定与 set_quota 并发
+    {
+        cpuAccount acct;
+        std::atomic<bool> stop = {false};
+        std::vector<std::thread> ts;
+        for (int t = 0; t < 4; ++t) {
+            ts.emplace_back([&acct, &stop, t] {
+                cpuAccount::tenant_t tenant = static_cast<cpuAccount::tenant_t>(t);
+                while (!stop.load()) {
+                    auto at = cpuAccount::clock::now();
+                    acct.record("x", &tenant, std::chrono::microseconds(1), at);
+                    acct.over_quota(tenant, at);
+                }
+            });
+        }
+        for (cpuAccount::tenant_t t = 0; t < 200; ++t) acct.set_quota(t, 1, ms(50));
+        stop = true;
+        for (auto &t : ts) t.join();
+        CHECK(acct.any_quota());
+    }
+
+    // workbranch 上的租户 CPU 记账
+    {
+        workbranch wb(4);
+        wb.enable_cpu_accounting(true);
+        for (int i = 0; i < 400; ++i) wb.submit_tenant(7, [] {});
+        wb.wait_tasks(5000);
+        CHECK(wb.tenant_cpu(7).tasks == 400);
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+// durablebranch：提交失败的任务留在日志中；重放时分支已关闭则构造函数抛出而不挂起，之后仍可正常重放；
+// 分支 abort 时排队中的任务不写 done 记录，析构不挂起，下次启动时重放
+#include "check.h"
+#include "libs/durable.h"
+#include <atomic>
+#include <cstdlib>
+#include <dirent.h>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using namespace sunshine;
+using namespace sunshine::details;
+
+static void remove_dir(const std::string &dir) {
+    if (DIR *d = ::opendir(dir.c_str())) {
+        while (dirent *e = ::readdir(d)) {
+            std::string name = e->d_name;
+            if (name != "." && name != "..") ::unlink((dir + "/" + name).c_str());
+        }
+        ::closedir(d);
+    }
+    ::rmdir(dir.c_str());
+}
+
+int main() {
+    char tmpl[] = "/tmp/durable_test_XXXXXX";
+    CHECK(::mkdtemp(tmpl) != nullptr);
+    std::string dir = tmpl;
+    const size_t seg = size_t(1) << 20;
+
+    std::atomic<int> ran = {0};
+    taskRegistry reg;
+    reg.add<int>(1, [&ran](const int &) { ++ran; });
+    std::promise<void> gate;
+    std::shared_future<void> open = gate.get_future().share();
+    reg.add<int>(2, [open](const int &) { open.wait(); });
+
+    workbranch closed_wb(1);
+    closed_wb.shutdown(shutdownMode::drain);
+
+    // 分支已关闭：submit 抛出，记录已落盘并保留
+    {
+        durablebranch db(dir, closed_wb, reg, seg);
+        for (int i = 0; i < 3; ++i) {
+            bool threw = false;
+            try {
+                db.submit(1, i);
+            } catch (const std::runtime_error &) {
+                threw = true;
+            }
+            CHECK(threw);
+        }
+        CHECK(db.num_pending() == 3);
+    }
+
+    // 重放时分支已关闭：构造函数抛出（而不是挂起在刷盘线程的 join 上）
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool threw = false;
+        try {
+            durablebranch db(dir, closed_wb, reg, seg);
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(elapsed_ms(start) < 5000);
+    }
+
+    // 正常重放：三个任务各执行一次，完成后日志中不再有待执行任务
+    {
+        workbranch wb(2);
+        {
+            durablebranch db(dir, wb, reg, seg);
+            db.submit(1, 42);
+        }
+        CHECK(ran.load() == 4);
+        durablebranch db(dir, wb, reg, seg);
+        CHECK(db.num_pending() == 0);
+    }
+    CHECK(ran.load() == 4);
+
+    // 分支 abort 时仍在排队的任务：析构不挂起，任务留在日志中，重启后重放
+    {
+        workbranch one(1);
+        {
+            std::unique_ptr<durablebranch> db(new durablebranch(dir, one, reg, seg));
+            db->submit(2, 0);
+            for (int i = 0; i < 5; ++i) db->submit(1, i);
+            std::thread closer([&one] { one.shutdown(shutdownMode::abort); });
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            gate.set_value();
+            closer.join();
+            auto start = std::chrono::steady_clock::now();
+            db.reset();
+            CHECK(elapsed_ms(start) < 5000);
+        }
+        CHECK(ran.load() == 4);
+        workbranch wb(2);
+        {
+            durablebranch db(dir, wb, reg, seg);
+        }
+        CHECK(ran.load() == 9);
+        durablebranch db(dir, wb, reg, seg);
+        CHECK(db.num_pending() == 0);
+    }
+
+    remove_dir(dir);
+    return 0;
+}
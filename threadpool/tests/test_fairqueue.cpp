@@ -0,0 +1,45 @@
+// fairQueue：按份额轮询出队；blocking 策略下 submit_tenant 总能唤醒挂起的 worker
+#include "check.h"
+#include "libs/workbranch.h"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+using namespace sunshine;
+using namespace sunshine::details;
+
+int main() {
+    // DRR：A 份额 3、B 份额 1，出队顺序为 AAAB AAAB ...
+    {
+        fairQueue<int> fq;
+        fq.set_weight(1, 3);
+        for (int i = 0; i < 12; ++i) fq.push_back(1, 1);
+        for (int i = 0; i < 12; ++i) fq.push_back(2, 2);
+        std::string order;
+        int v;
+        for (int i = 0; i < 8; ++i) {
+            CHECK(fq.try_pop(v));
+            order += v == 1 ? 'A' : 'B';
+        }
+        CHECK(order == "AAABAAAB");
+        CHECK(fq.getLength() == 16);
+    }
+
+    // 挂起/唤醒握手：worker 频繁挂起时，每个租户任务都能及时执行
+    {
+        workbranch wb(4, waitStrategy::blocking);
+        std::atomic<int> done = {0};
+        const int rounds = 2000;
+        for (int i = 0; i < rounds; ++i) {
+            wb.submit_tenant(static_cast<uint32_t>(i % 3), [&done] { ++done; });
+            // 让 worker 有机会在两次提交之间挂起
+            if (i % 16 == 0) std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        auto start = std::chrono::steady_clock::now();
+        while (done.load() < rounds && elapsed_ms(start) < 5000) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        CHECK(done.load() == rounds);
+        CHECK(wb.tenant_stats(0).dequeued + wb.tenant_stats(1).dequeued + wb.tenant_stats(2).dequeued == rounds);
+    }
+    return 0;
+}
@@ -0,0 +1,47 @@
+// submit_hedged：两份副本各自持有可调用对象的拷贝；只有一个分支时不对冲
+#include "check.h"
+#include "libs/workspace.h"
+#include <atomic>
+#include <thread>
+
+using namespace sunshine;
+
+// 带可变状态的可调用对象：每份拷贝独立计数，两份副本共享同一对象时 calls 会超过 1
+struct stateful {
+    int calls = 0;
+    std::atomic<int> *started;
+
+    int operator()() {
+        ++calls;
+        ++*started;
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        return calls;
+    }
+};
+
+int main() {
+    // 两个分支：首发副本慢于 delay，对冲副本也会执行；每份副本看到的 calls 都是 1
+    {
+        std::atomic<int> started = {0};
+        workspace ws;
+        ws.attach(new workbranch(1));
+        ws.attach(new workbranch(1));
+        auto fut = ws.submit_hedged(stateful{0, &started}, std::chrono::microseconds(1000));
+        CHECK(fut.get() == 1);
+        auto start = std::chrono::steady_clock::now();
+        while (started.load() < 2 && elapsed_ms(start) < 2000) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        CHECK(started.load() == 2);
+    }
+
+    // 只有一个分支：不会在同一分支上再提交一份
+    {
+        std::atomic<int> started = {0};
+        workspace ws;
+        ws.attach(new workbranch(2));
+        auto fut = ws.submit_hedged(stateful{0, &started}, std::chrono::microseconds(1000));
+        CHECK(fut.get() == 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        CHECK(started.load() == 1);
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+// inline_if_busy：分支饱和（所有 worker 都在忙且积压超过阈值）时在提交线程上执行，否则照常排队
+#include "check.h"
+#include "libs/workbranch.h"
+#include <atomic>
+#include <future>
+#include <thread>
+
+using namespace sunshine;
+using namespace sunshine::details;
+
+int main() {
+    auto self = std::this_thread::get_id();
+
+    // 未饱和：交给 worker
+    {
+        workbranch wb(2);
+        auto fut = wb.submit<inline_if_busy>([] { return std::this_thread::get_id(); });
+        CHECK(fut.get() != self);
+    }
+
+    // 饱和：两个 worker 都被占住、队列有积压时由提交线程执行；阈值之内仍排队
+    {
+        workbranch wb(2);
+        std::atomic<bool> release = {false};
+        std::atomic<int> started = {0};
+        for (int i = 0; i < 2; ++i) {
+            wb.submit([&] {
+                ++started;
+                while (!release.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            });
+        }
+        while (started.load() < 2) std::this_thread::yield();
+        wb.set_inline_threshold(3);
+        for (int i = 0; i < 3; ++i) wb.submit([] {});
+
+        // 积压 3 个，未超过阈值：排队
+        auto queued = wb.submit<inline_if_busy>([] { return std::this_thread::get_id(); });
+        CHECK(queued.wait_for(std::chrono::milliseconds(0)) == std::future_status::timeout);
+
+        // 积压 4 个，超过阈值：立即在本线程执行，future 已就绪
+        auto inlined = wb.submit<inline_if_busy>([] { return std::this_thread::get_id(); });
+        CHECK(inlined.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready);
+        CHECK(inlined.get() == self);
+
+        bool ran_here = false;
+        wb.submit<inline_if_busy>([&ran_here, self] { ran_here = std::this_thread::get_id() == self; });
+        CHECK(ran_here);
+
+        release = true;
+        CHECK(queued.get() != self);
+        CHECK(wb.wait_tasks(5000));
+    }
+    return 0;
+}
@@ -0,0 +1,143 @@
+// submit_keyed：一致性哈希把同一 key 固定到同一 worker / 分支，归属方过载时有界溢出；选择节点不分配内存
+#include "check.h"
+#include "libs/hashring.h"
+#include "libs/workspace.h"
+#include <atomic>
+#include <cstdlib>
+#include <future>
+#include <map>
+#include <mutex>
+#include <new>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace sunshine;
+using namespace sunshine::details;
+
+// 统计本进程的堆分配次数
+static std::atomic<size_t> allocations = {0};
+
+void *operator new(std::size_t n) {
+    ++allocations;
+    if (void *p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+int main() {
+    // 哈希环：选择确定；增加第 5 个节点只迁移约 1/5 的 key，且迁移的 key 全部落到新节点
+    {
+        hashRing<int> ring(64);
+        for (int n = 1; n <= 4; ++n) ring.add(n, n);
+        auto none = [](int) { return size_t(0); };
+        std::vector<int> before;
+        for (uint64_t k = 0; k < 10000; ++k) before.push_back(ring.pick(key_hash(k), 1.25, 0, none));
+        for (uint64_t k = 0; k < 10000; ++k) CHECK(ring.pick(key_hash(k), 1.25, 0, none) == before[k]);
+        std::map<int, int> share;
+        for (int n : before) ++share[n];
+        CHECK(share.size() == 4);
+        for (auto &each : share) CHECK(each.second > 1000 && each.second < 4000);
+
+        ring.add(5, 5);
+        int moved = 0;
+        for (uint64_t k = 0; k < 10000; ++k) {
+            int now = ring.pick(key_hash(k), 1.25, 0, none);
+            if (now != before[k]) {
+                ++moved;
+                CHECK(now == 5);
+            }
+        }
+        CHECK(moved > 1000 && moved < 3500);
+
+        // 删除后恢复原有映射
+        ring.remove(5, 5);
+        CHECK(ring.size() == 4);
+        for (uint64_t k = 0; k < 10000; ++k) CHECK(ring.pick(key_hash(k), 1.25, 0, none) == before[k]);
+    }
+
+    // 有界负载：归属节点达到上限时溢出到其他节点，未超限时保持归属
+    {
+        hashRing<int> ring(64);
+        for (int n = 1; n <= 4; ++n) ring.add(n, n);
+        uint64_t h = key_hash(7);
+        int home = ring.pick(h, 1.25, 0, [](int) { return size_t(0); });
+        // 总负载 40：上限 ceil(1.25 * 41 / 4) = 13
+        auto busy = [home](int n) { return n == home ? size_t(13) : size_t(9); };
+        int spill = ring.pick(h, 1.25, 40, busy);
+        CHECK(spill != home && spill != 0);
+        auto light = [home](int n) { return n == home ? size_t(12) : size_t(9); };
+        CHECK(ring.pick(h, 1.25, 39, light) == home);
+        // floor 抬高上限：轻载时不溢出
+        auto tiny = [home](int n) { return n == home ? size_t(3) : size_t(0); };
+        CHECK(ring.pick(h, 1.25, 3, tiny, 4) == home);
+        CHECK(ring.pick(h, 1.25, 3, tiny, 1) != home);
+
+        // 溢出查找不分配内存
+        size_t before = allocations.load();
+        size_t spilled = 0;
+        for (uint64_t k = 0; k < 10000; ++k) spilled += ring.pick(key_hash(k), 1.25, 40, busy) != home;
+        CHECK(allocations.load() == before);
+        CHECK(spilled > 0);
+    }
+
+    // workbranch：每个 key 固定在一个 worker 上，不同 key 分散到多个 worker
+    {
+        workbranch wb(4);
+        std::set<std::thread::id> used;
+        for (int key = 0; key < 64; ++key) {
+            std::set<std::thread::id> seen;
+            for (int i = 0; i < 5; ++i) {
+                seen.insert(wb.submit_keyed(key, [] { return std::this_thread::get_id(); }).get());
+            }
+            CHECK(seen.size() == 1);
+            used.insert(*seen.begin());
+        }
+        CHECK(used.size() > 1);
+    }
+
+    // 热点 key：归属 worker 积压达到上限后溢出，不会全部堆在一个 worker 上
+    {
+        workbranch wb(4);
+        std::promise<void> gate;
+        std::shared_future<void> open = gate.get_future().share();
+        std::mutex mtx;
+        std::set<std::thread::id> seen;
+        for (int i = 0; i < 200; ++i) {
+            wb.submit_keyed(std::string("hot"), [&, open] {
+                open.wait();
+                std::lock_guard<std::mutex> lock(mtx);
+                seen.insert(std::this_thread::get_id());
+            });
+        }
+        gate.set_value();
+        CHECK(wb.wait_tasks(10000));
+        CHECK(seen.size() > 1);
+    }
+
+    // workspace：同一 key 始终落在同一分支的同一 worker 上
+    {
+        workspace spc;
+        spc.attach(new workbranch(2));
+        spc.attach(new workbranch(2));
+        spc.attach(new workbranch(2));
+        std::set<std::thread::id> used;
+        for (int key = 0; key < 32; ++key) {
+            std::set<std::thread::id> seen;
+            for (int i = 0; i < 5; ++i) {
+                seen.insert(spc.submit_keyed(key, [] { return std::this_thread::get_id(); }).get());
+            }
+            CHECK(seen.size() == 1);
+            used.insert(*seen.begin());
+        }
+        CHECK(used.size() > 2);
+    }
+    return 0;
+}
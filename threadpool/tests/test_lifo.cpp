@@ -0,0 +1,43 @@
+// LIFO next 槽：默认关闭时，任务内提交后续任务并等待它不会自锁；开启后后续任务在同一 worker 上紧接执行
+#include "check.h"
+#include "libs/workbranch.h"
+#include <atomic>
+#include <future>
+#include <thread>
+
+using namespace sunshine;
+using namespace sunshine::details;
+
+// 在任务内提交一个 void 后续任务并阻塞等待它完成
+static bool submit_then_wait(workbranch &wb) {
+    auto outer = wb.submit([&wb]() -> bool {
+        auto done = std::make_shared<std::promise<void>>();
+        auto fut = done->get_future();
+        wb.submit([done] { done->set_value(); });
+        return fut.wait_for(std::chrono::seconds(5)) == std::future_status::ready;
+    });
+    return outer.get();
+}
+
+int main() {
+    for (auto strategy : {waitStrategy::lowlatancy, waitStrategy::blocking, waitStrategy::adaptive}) {
+        workbranch wb(2, strategy);
+        for (int i = 0; i < 20; ++i) CHECK(submit_then_wait(wb));
+    }
+
+    // 开启后：后续任务进入提交者的 next 槽，只能由同一个 worker 执行
+    workbranch wb(4);
+    wb.enable_lifo(true);
+    std::atomic<int> same = {0};
+    for (int i = 0; i < 100; ++i) {
+        wb.submit([&wb, &same] {
+            auto parent = std::this_thread::get_id();
+            wb.submit([&same, parent] {
+                if (std::this_thread::get_id() == parent) ++same;
+            });
+        });
+    }
+    wb.wait_tasks();
+    CHECK(same.load() == 100);
+    return 0;
+}
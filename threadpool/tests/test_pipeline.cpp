@@ -0,0 +1,73 @@
+// make_pipeline：单令牌下大量元素不递归耗尽栈；按序阶段保持源顺序；阶段异常经 future 抛出
+#include "check.h"
+#include "libs/pipeline.h"
+#include <atomic>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+using namespace sunshine;
+using sunshine::details::workbranch;
+
+int main() {
+    // tokens = 1：每个元素走完后由同一任务接着取下一个，1M 个元素不应增长栈
+    {
+        workbranch wb(2);
+        const int total = 1000000;
+        int next = 0;
+        long long sum = 0;
+        make_pipeline(wb, 1, [&]() -> std::optional<int> {
+            if (next == total) return std::nullopt;
+            return next++;
+        })
+            .then(stageMode::parallel, [](int v) { return v + 1; })
+            .then(stageMode::serial_out_of_order, [&sum](int v) { sum += v; })
+            .run()
+            .get();
+        CHECK(sum == static_cast<long long>(total) * (total + 1) / 2);
+    }
+
+    // 多令牌：并行阶段乱序完成，按序阶段仍按源顺序输出
+    for (stageMode mid : {stageMode::parallel, stageMode::serial_out_of_order, stageMode::serial_in_order}) {
+        workbranch wb(4);
+        const int total = 200000;
+        int next = 0;
+        std::vector<int> out;
+        make_pipeline(wb, 16, [&]() -> std::optional<int> {
+            if (next == total) return std::nullopt;
+            return next++;
+        })
+            .then(stageMode::parallel, [](int v) { return v * 2; })
+            .then(mid, [](int v) { return v / 2; })
+            .then(stageMode::serial_in_order, [&out](int v) { out.push_back(v); })
+            .run()
+            .get();
+        CHECK(out.size() == static_cast<size_t>(total));
+        bool ordered = true;
+        for (int i = 0; i < total; ++i) ordered = ordered && out[i] == i;
+        CHECK(ordered);
+    }
+
+    // 阶段抛出异常：停止取新元素，在途元素排空后 future 携带该异常
+    {
+        workbranch wb(2);
+        int next = 0;
+        std::atomic<int> finished = {0};
+        bool threw = false;
+        try {
+            make_pipeline(wb, 4, [&]() -> std::optional<int> { return next++; })
+                .then(stageMode::parallel, [](int v) {
+                    if (v == 1000) throw std::runtime_error("bad item");
+                    return v;
+                })
+                .then(stageMode::serial_in_order, [&finished](int) { ++finished; })
+                .run()
+                .get();
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(finished.load() >= 1000 && finished.load() < 1010);
+    }
+    return 0;
+}
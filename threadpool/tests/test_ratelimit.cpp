@@ -0,0 +1,90 @@
+// 限速：开始执行的速率受令牌桶限制；析构时等待 mailbox 中被限速的定向任务，期间不空转；
+// rate_limiter 跨分支限制一类任务的提交速率
+#include "check.h"
+#include "libs/ratelimit.h"
+#include "libs/workbranch.h"
+#include <atomic>
+#include <ctime>
+#include <future>
+#include <memory>
+#include <thread>
+
+using namespace sunshine;
+using namespace sunshine::details;
+
+int main() {
+    // 20 个/秒、突发 1：10 个任务至少需要约 450ms
+    {
+        workbranch wb(2);
+        wb.set_rate_limit(20, 1);
+        std::atomic<int> ran = {0};
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 10; ++i) wb.submit([&ran] { ++ran; });
+        CHECK(wb.wait_tasks(5000));
+        CHECK(ran.load() == 10);
+        CHECK(elapsed_ms(start) >= 400);
+    }
+
+    // 析构时 mailbox 中仍有被限速的定向任务：全部执行完才退出，等待令牌时睡眠而不是忙等
+    {
+        std::atomic<int> ran = {0};
+        std::unique_ptr<workbranch> wb(new workbranch(1, waitStrategy::blocking));
+        wb->set_rate_limit(20, 1);
+        for (int i = 0; i < 12; ++i) wb->submit_keyed(i, [&ran] { ++ran; });
+        auto start = std::chrono::steady_clock::now();
+        std::clock_t cpu_start = std::clock();
+        wb.reset();
+        double cpu_ms = 1000.0 * static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+        auto wall_ms = elapsed_ms(start);
+        CHECK(ran.load() == 12);
+        CHECK(wall_ms >= 300);
+        // 空转时 CPU 时间与墙钟时间相当
+        CHECK(cpu_ms < wall_ms / 4.0);
+    }
+
+    // tokenBucket：突发容量内立即取得，超出后失败；退还的令牌可再取；预订按顺序排到未来
+    {
+        tokenBucket bucket(10, 5);
+        for (int i = 0; i < 5; ++i) CHECK(bucket.try_acquire());
+        CHECK(!bucket.try_acquire());
+        bucket.refund();
+        CHECK(bucket.try_acquire());
+        auto first = bucket.reserve();
+        auto second = bucket.reserve();
+        CHECK(first > std::chrono::milliseconds(50));
+        CHECK(second - first >= std::chrono::milliseconds(95));
+        bucket.configure(0);
+        CHECK(bucket.unlimited());
+        CHECK(bucket.try_acquire(1000));
+    }
+
+    // rate_limiter：两个分支共用 50 个/秒的额度，超出的任务经 timer 延后，返回值任务的 future 照常就绪
+    {
+        workbranch a(2), b(2);
+        timer tm;
+        rate_limiter limiter(50, 1, tm);
+        std::atomic<int> ran = {0};
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < 10; ++i) {
+            limiter.submit(a, [&ran] { ++ran; });
+            limiter.submit(b, [&ran] { ++ran; });
+        }
+        auto fut = limiter.submit(a, [] { return 42; });
+        CHECK(limiter.num_delayed() >= 19);
+        CHECK(limiter.num_deferred() > 0);
+        CHECK(fut.get() == 42);
+        CHECK(elapsed_ms(start) >= 350);
+        CHECK(a.wait_tasks(5000) && b.wait_tasks(5000));
+        CHECK(ran.load() == 20);
+        CHECK(limiter.num_deferred() == 0);
+
+        // 取消限速后立即提交
+        limiter.set_rate(0);
+        uint64_t delayed = limiter.num_delayed();
+        for (int i = 0; i < 100; ++i) limiter.submit(a, [&ran] { ++ran; });
+        CHECK(limiter.num_delayed() == delayed);
+        CHECK(a.wait_tasks(5000));
+        CHECK(ran.load() == 120);
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+// 负载信号与 workspace 路由：无锁读取的队列长度 / 忙碌 worker 数 / 耗时 EWMA，按预期时延选分支
+#include "check.h"
+#include "libs/workspace.h"
+#include <atomic>
+#include <future>
+#include <thread>
+
+using namespace sunshine;
+using namespace sunshine::details;
+
+// 等待条件成立（最多 5 秒）
+template <typename P>
+static bool eventually(P &&pred) {
+    auto start = std::chrono::steady_clock::now();
+    while (!pred()) {
+        if (elapsed_ms(start) > 5000) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+int main() {
+    // taskQueue：长度副本随入队出队更新，空队列 try_pop 直接返回
+    {
+        taskQueue<int> q;
+        int v = 0;
+        CHECK(!q.try_pop(v));
+        for (int i = 0; i < 10; ++i) q.push_back(i);
+        q.push_front(-1);
+        CHECK(q.getLength() == 11);
+        CHECK(q.try_pop(v) && v == -1);
+        CHECK(q.getLength() == 10);
+        while (q.try_pop(v)) {
+        }
+        CHECK(q.getLength() == 0 && v == 9);
+    }
+
+    // 负载信号：worker 数、忙碌 worker 数、排队任务使预期时延上升
+    {
+        workbranch wb(2);
+        CHECK(eventually([&] { return wb.load_signal().workers.load() == 2; }));
+        CHECK(wb.num_idle() == 2);
+        double idle = wb.expected_delay();
+        CHECK(idle > 0);
+
+        std::promise<void> gate;
+        std::shared_future<void> open = gate.get_future().share();
+        for (int i = 0; i < 8; ++i) wb.submit([open] { open.wait(); });
+        CHECK(eventually([&] { return wb.load_signal().active.load() == 2; }));
+        CHECK(wb.num_idle() == 0);
+        // 尚无耗时样本：(6 排队 + 2 执行 + 1) / 2 个 worker，是空闲时的 9 倍
+        CHECK(wb.expected_delay() >= 8 * idle);
+        gate.set_value();
+        CHECK(wb.wait_tasks(5000));
+        CHECK(eventually([&] { return wb.load_signal().active.load() == 0; }));
+    }
+
+    // 耗时 EWMA：未开启统计时也按采样维持
+    {
+        workbranch wb(1);
+        for (int i = 0; i < 64; ++i) wb.submit([] { std::this_thread::sleep_for(std::chrono::microseconds(200)); });
+        CHECK(wb.wait_tasks(5000));
+        CHECK(wb.load_signal().service_ns.load() >= 100000);
+    }
+
+    // workspace：积压的分支不再接收新任务，提交落到预期时延更小的分支
+    {
+        workspace spc;
+        auto busy = new workbranch(2);
+        auto free = new workbranch(2);
+        spc.attach(busy);
+        spc.attach(free);
+        // 两个分支先积累耗时样本；busy 积压 200 个任务，耗时 EWMA 的抖动不影响比较结果
+        for (auto br : {busy, free}) {
+            br->enable_timing(true);
+            for (int i = 0; i < 32; ++i) br->submit([] { std::this_thread::sleep_for(std::chrono::microseconds(100)); });
+            CHECK(br->wait_tasks(5000));
+        }
+
+        std::promise<void> gate;
+        std::shared_future<void> open = gate.get_future().share();
+        for (int i = 0; i < 200; ++i) busy->submit([open] { open.wait(); });
+        CHECK(eventually([&] { return busy->load_signal().active.load() == 2; }));
+        CHECK(busy->expected_delay() > free->expected_delay());
+
+        // 若被路由到 busy，任务要等 gate 打开才执行
+        for (int i = 0; i < 10; ++i) {
+            auto fut = spc.submit([] { return 1; });
+            CHECK(fut.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+        }
+        CHECK(busy->num_tasks() == 198);
+        gate.set_value();
+        CHECK(busy->wait_tasks(5000));
+    }
+    return 0;
+}
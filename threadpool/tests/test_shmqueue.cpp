@@ -0,0 +1,127 @@
+// shmhost / shmbranch：经共享内存队列执行已注册任务，结果与异常回到 future；并发提交时队列满的背压不丢请求
+#include "check.h"
+#if defined(__linux__)
+#include "libs/shmqueue.h"
+#include "libs/workspace.h"
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace sunshine;
+
+struct add {
+    int a, b;
+};
+
+int main() {
+    taskRegistry reg;
+    reg.add<add>(1, [](const add &x) { return x.a + x.b; });
+    reg.add<int>(2, [](const int &) -> int { throw std::runtime_error("bad input"); });
+    reg.add<std::string>(3, [](const std::string &s) { return s + s; });
+    std::promise<void> gate;
+    std::shared_future<void> open = gate.get_future().share();
+    reg.add<int>(4, [open](const int &x) {
+        open.wait();
+        return x;
+    });
+
+    // 命名段：结果、异常与 std::string 参数
+    {
+        workbranch wb(2);
+        std::string name = "/sunshine_test_" + std::to_string(::getpid());
+        shmhost host(name, wb, reg, 64);
+        shmbranch client(name);
+        CHECK(client.submit<int>(1, add{1, 2}).get() == 3);
+        CHECK(client.submit<std::string>(3, std::string("ab")).get() == "abab");
+        bool threw = false;
+        try {
+            client.submit<int>(2, 0).get();
+        } catch (const std::runtime_error &ex) {
+            threw = std::string(ex.what()).find("bad input") != std::string::npos;
+        }
+        CHECK(threw);
+
+        // 参数超出描述符大小：提交时直接抛出
+        threw = false;
+        try {
+            client.submit<std::string>(3, std::string(4096, 'x'));
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(client.num_tasks() == 0);
+
+        // 同一段只允许一个客户端
+        threw = false;
+        try {
+            shmbranch second(name);
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+
+    // 匿名 memfd 段：4 个线程各提交 5000 个请求（远超 64 个槽位）
+    {
+        workbranch wb(4);
+        shmhost host("", wb, reg, 64);
+        shmbranch client(::dup(host.handle()));
+        std::vector<std::thread> ts;
+        std::vector<long long> sums(4, 0);
+        for (int t = 0; t < 4; ++t) {
+            ts.emplace_back([&client, &sums, t] {
+                std::vector<std::future<int>> futs;
+                for (int i = 0; i < 5000; ++i) futs.push_back(client.submit<int>(1, add{i, t}));
+                for (auto &f : futs) sums[t] += f.get();
+            });
+        }
+        for (auto &th : ts) th.join();
+        for (int t = 0; t < 4; ++t) CHECK(sums[t] == 5000LL * 4999 / 2 + 5000LL * t);
+    }
+
+    // 经 workspace::submit_remote 提交
+    {
+        workbranch wb(1);
+        shmhost host("", wb, reg);
+        workspace ws;
+        ws.attach(new shmbranch(::dup(host.handle())));
+        CHECK(ws.submit_remote<int>(1, add{20, 22}).get() == 42);
+    }
+
+    // 分支 abort 时仍在排队的请求：客户端收到取消失败，shmhost 析构不会挂起
+    {
+        workbranch wb(1);
+        shmhost host("", wb, reg);
+        shmbranch client(::dup(host.handle()));
+        auto running = client.submit<int>(4, 1);
+        std::vector<std::future<int>> queued;
+        for (int i = 0; i < 5; ++i) queued.push_back(client.submit<int>(1, add{i, i}));
+        auto start = std::chrono::steady_clock::now();
+        while (wb.num_tasks() < 5 && elapsed_ms(start) < 5000) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        CHECK(wb.num_tasks() == 5);
+        std::thread closer([&wb] { wb.shutdown(shutdownMode::abort); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        gate.set_value();
+        closer.join();
+        CHECK(running.get() == 1);
+        for (auto &f : queued) {
+            CHECK(f.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+            bool cancelled = false;
+            try {
+                f.get();
+            } catch (const std::runtime_error &ex) {
+                cancelled = std::string(ex.what()).find("cancelled") != std::string::npos;
+            }
+            CHECK(cancelled);
+        }
+    }
+    return 0;
+}
+#else
+int main() {
+    return 0;
+}
+#endif
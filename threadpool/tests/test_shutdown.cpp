@@ -0,0 +1,103 @@
+// shutdown / wait_tasks：超时按期返回；排队任务要么执行要么被取消，不会两者兼有；
+// 被取消的 workspace::submit_once 释放其 key
+#include "check.h"
+#include "libs/workbranch.h"
+#include "libs/workspace.h"
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+using namespace sunshine;
+using namespace sunshine::details;
+
+int main() {
+    using ms = std::chrono::milliseconds;
+
+    // wait_tasks 超时后按时返回，之后的 wait_tasks 仍然正确计数
+    {
+        workbranch wb(2);
+        std::atomic<bool> release = {false};
+        wb.submit([&release] {
+            while (!release.load()) std::this_thread::sleep_for(ms(1));
+        });
+        std::this_thread::sleep_for(ms(20));
+        auto start = std::chrono::steady_clock::now();
+        CHECK(!wb.wait_tasks(100));
+        CHECK(elapsed_ms(start) < 1000);
+        release = true;
+        CHECK(wb.wait_tasks(5000));
+        for (int i = 0; i < 3; ++i) CHECK(wb.wait_tasks(5000));
+    }
+
+    // drain 超时：长任务仍在执行时按期返回，排队任务被取消
+    {
+        workbranch wb(1);
+        std::atomic<bool> release = {false};
+        std::atomic<int> ran = {0};
+        wb.submit([&release] {
+            while (!release.load()) std::this_thread::sleep_for(ms(1));
+        });
+        std::vector<std::future<int>> futs;
+        for (int i = 0; i < 10; ++i) futs.push_back(wb.submit([&ran, i] { ++ran; return i; }));
+        std::this_thread::sleep_for(ms(20));
+        auto start = std::chrono::steady_clock::now();
+        CHECK(!wb.shutdown(shutdownMode::drain, 200));
+        CHECK(elapsed_ms(start) < 1500);
+        release = true;
+        for (auto &f : futs) {
+            bool cancelled = false;
+            try {
+                f.get();
+            } catch (const task_cancelled &) {
+                cancelled = true;
+            }
+            CHECK(cancelled);
+        }
+        CHECK(ran.load() == 0);
+    }
+
+    // abort 与正在取任务的 worker 并发：每个任务恰好执行一次或被取消一次
+    for (int round = 0; round < 20; ++round) {
+        workbranch wb(4);
+        std::atomic<int> ran = {0};
+        std::vector<std::future<int>> futs;
+        for (int i = 0; i < 2000; ++i) futs.push_back(wb.submit([&ran] { return ++ran; }));
+        wb.shutdown(shutdownMode::abort);
+        int cancelled = 0;
+        for (auto &f : futs) {
+            try {
+                f.get();
+            } catch (const task_cancelled &) {
+                ++cancelled;
+            }
+        }
+        CHECK(ran.load() + cancelled == 2000);
+    }
+
+    // workspace::submit_once 的任务被 abort 取消：future 以 task_cancelled 失败，key 随之释放
+    {
+        workspace ws;
+        auto wb = new workbranch(1);
+        auto id = ws.attach(wb);
+        std::promise<void> gate;
+        std::shared_future<void> open = gate.get_future().share();
+        wb->submit([open] { open.wait(); });
+        auto once = ws.submit_once("k", [] { return 1; });
+        std::thread closer([wb] { wb->shutdown(shutdownMode::abort); });
+        std::this_thread::sleep_for(ms(20));
+        gate.set_value();
+        closer.join();
+        bool cancelled = false;
+        try {
+            once.get();
+        } catch (const task_cancelled &) {
+            cancelled = true;
+        }
+        CHECK(cancelled);
+        ws.detach(id);
+        ws.attach(new workbranch(1));
+        CHECK(ws.submit_once("k", [] { return 2; }).get() == 2);
+    }
+    return 0;
+}
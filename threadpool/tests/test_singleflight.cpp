@@ -0,0 +1,81 @@
+// submit_once / singleflight：同 key 在途时复用同一个 future；提交失败时移除条目并把异常交给等待者
+#include "check.h"
+#include "libs/workspace.h"
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+using namespace sunshine;
+
+int main() {
+    // 在途去重：同一 key 只执行一次
+    {
+        workbranch wb(2);
+        std::atomic<int> runs = {0};
+        std::atomic<bool> release = {false};
+        auto slow = [&] {
+            ++runs;
+            while (!release.load()) std::this_thread::yield();
+            return 42;
+        };
+        auto a = wb.submit_once("k", slow);
+        auto b = wb.submit_once("k", slow);
+        release = true;
+        CHECK(a.get() == 42 && b.get() == 42);
+        CHECK(runs.load() == 1);
+    }
+
+    // workspace 没有可用分支：每次调用都抛出，而不是返回一个永远不会就绪的 future
+    {
+        workspace ws;
+        for (int i = 0; i < 2; ++i) {
+            bool threw = false;
+            try {
+                ws.submit_once("k", [] { return 1; });
+            } catch (const std::runtime_error &) {
+                threw = true;
+            }
+            CHECK(threw);
+        }
+        // 分支已关闭
+        auto id = ws.attach(new workbranch(1));
+        ws[id].shutdown(shutdownMode::abort);
+        bool threw = false;
+        try {
+            ws.submit_once("k", [] { return 1; });
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+
+    // 提交失败前加入的等待者收到同一异常；之后同 key 的调用重新提交
+    {
+        details::singleflight sf;
+        std::atomic<bool> go = {false};
+        std::thread leader([&] {
+            try {
+                sf.run("k", [] { return 1; }, [&](std::function<void()> &&) {
+                    while (!go.load()) std::this_thread::yield();
+                    throw std::runtime_error("launch failed");
+                });
+            } catch (const std::runtime_error &) {
+            }
+        });
+        while (sf.size() == 0) std::this_thread::yield();
+        auto follower = sf.run("k", [] { return 2; }, [](std::function<void()> &&t) { t(); });
+        go = true;
+        leader.join();
+        bool threw = false;
+        try {
+            follower.get();
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(sf.size() == 0);
+        auto again = sf.run("k", [] { return 3; }, [](std::function<void()> &&t) { t(); });
+        CHECK(again.get() == 3);
+    }
+    return 0;
+}
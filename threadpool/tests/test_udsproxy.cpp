@@ -0,0 +1,111 @@
+// udshost / udsbranch：经 Unix 域套接字执行已注册任务；大参数、流水线并发请求、服务端关闭后客户端失败、
+// 分支 abort 时排队中的请求以取消失败
+#include "check.h"
+#include "libs/udsproxy.h"
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace sunshine;
+using sunshine::details::workbranch;
+
+int main() {
+    taskRegistry reg;
+    reg.add<int>(1, [](const int &x) { return x * 2; });
+    reg.add<int>(2, [](const int &) -> int { throw std::runtime_error("bad input"); });
+    reg.add<std::string>(3, [](const std::string &s) { return s.size(); });
+    std::promise<void> gate;
+    std::shared_future<void> open = gate.get_future().share();
+    reg.add<int>(4, [open](const int &x) {
+        open.wait();
+        return x;
+    });
+
+    std::string path = "/tmp/sunshine_uds_" + std::to_string(::getpid()) + ".sock";
+    workbranch wb(4);
+    std::unique_ptr<udshost> host(new udshost(path, wb, reg));
+
+    // 结果、异常与超过共享内存描述符大小的参数
+    {
+        udsbranch client(path);
+        CHECK(client.submit<int>(1, 21).get() == 42);
+        bool threw = false;
+        try {
+            client.submit<int>(2, 0).get();
+        } catch (const std::runtime_error &ex) {
+            threw = std::string(ex.what()).find("bad input") != std::string::npos;
+        }
+        CHECK(threw);
+        CHECK(client.submit<size_t>(3, std::string(1 << 20, 'x')).get() == size_t(1) << 20);
+    }
+
+    // 两个连接各由 2 个线程连续发送 5000 个请求（不等待响应）
+    {
+        udsbranch a(path), b(path);
+        std::vector<std::thread> ts;
+        std::vector<long long> sums(4, 0);
+        for (int t = 0; t < 4; ++t) {
+            ts.emplace_back([&, t] {
+                udsbranch &c = t % 2 ? a : b;
+                std::vector<std::future<int>> futs;
+                for (int i = 0; i < 5000; ++i) futs.push_back(c.submit<int>(1, i));
+                for (auto &f : futs) sums[t] += f.get();
+            });
+        }
+        for (auto &th : ts) th.join();
+        for (long long s : sums) CHECK(s == 5000LL * 4999);
+    }
+
+    // 服务端关闭：客户端感知连接断开，之后的提交抛出
+    {
+        udsbranch client(path);
+        CHECK(client.submit<int>(1, 1).get() == 2);
+        host.reset();
+        auto start = std::chrono::steady_clock::now();
+        bool closed = false;
+        while (!closed && elapsed_ms(start) < 5000) {
+            try {
+                client.submit<int>(1, 1).get();
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            } catch (const std::runtime_error &) {
+                closed = true;
+            }
+        }
+        CHECK(closed);
+    }
+
+    // 分支 abort 时仍在排队的请求：客户端收到取消失败，udshost 析构不会挂起
+    {
+        std::string path2 = path + ".abort";
+        workbranch one(1);
+        std::unique_ptr<udshost> host2(new udshost(path2, one, reg));
+        udsbranch client(path2);
+        auto running = client.submit<int>(4, 1);
+        std::vector<std::future<int>> queued;
+        for (int i = 0; i < 5; ++i) queued.push_back(client.submit<int>(1, i));
+        auto start = std::chrono::steady_clock::now();
+        while (one.num_tasks() < 5 && elapsed_ms(start) < 5000) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        CHECK(one.num_tasks() == 5);
+        std::thread closer([&one] { one.shutdown(shutdownMode::abort); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        gate.set_value();
+        closer.join();
+        CHECK(running.get() == 1);
+        for (auto &f : queued) {
+            CHECK(f.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+            bool cancelled = false;
+            try {
+                f.get();
+            } catch (const std::runtime_error &ex) {
+                cancelled = std::string(ex.what()).find("cancelled") != std::string::npos;
+            }
+            CHECK(cancelled);
+        }
+        host2.reset();
+    }
+    return 0;
+}
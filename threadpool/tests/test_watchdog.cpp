@@ -0,0 +1,62 @@
+// 看门狗：卡住的任务只回调一次，回调在不持有分支锁的情况下执行（可以在回调里访问分支）
+#include "check.h"
+#include "libs/supervisor.h"
+#include "libs/workbranch.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+
+using namespace sunshine;
+using namespace sunshine::details;
+
+int main() {
+    using ms = std::chrono::milliseconds;
+
+    // 直接扫描：同一个卡住的任务多次扫描只回调一次
+    {
+        workbranch wb(2);
+        wb.enable_watchdog(true);
+        std::atomic<int> calls = {0};
+        std::atomic<bool> release = {false};
+        wb.set_stuck_handler([&](const workbranch::stuckTask &st) {
+            CHECK(st.elapsed >= ms(50));
+            CHECK(std::string(st.tag ? st.tag : "") == "slow");
+            // 回调中再次访问分支（持锁回调会在这里死锁）
+            CHECK(wb.num_workers() == 2);
+            CHECK(wb.stuck_tasks().size() == 1);
+            ++calls;
+        });
+        wb.submit(tagged("slow", [&release] {
+            while (!release.load()) std::this_thread::sleep_for(ms(1));
+        }));
+        std::this_thread::sleep_for(ms(80));
+        CHECK(wb.scan_stuck(ms(50)) == 1);
+        CHECK(wb.scan_stuck(ms(50)) == 1);
+        CHECK(calls.load() == 1);
+        release = true;
+        wb.wait_tasks(5000);
+        CHECK(wb.scan_stuck(ms(50)) == 0);
+        CHECK(wb.num_stuck() == 0);
+    }
+
+    // 经由 supervisor 转交回调
+    {
+        auto wb = std::make_shared<workbranch>(1);
+        std::atomic<int> calls = {0};
+        std::atomic<bool> release = {false};
+        {
+            supervisor sp(1, 2, 20);
+            sp.set_watchdog(ms(40), false, [&calls](const workbranch::stuckTask &) { ++calls; });
+            sp.add_super(wb);
+            wb->submit([&release] {
+                while (!release.load()) std::this_thread::sleep_for(ms(1));
+            });
+            auto start = std::chrono::steady_clock::now();
+            while (calls.load() == 0 && elapsed_ms(start) < 5000) std::this_thread::sleep_for(ms(5));
+            CHECK(calls.load() == 1);
+        }
+        release = true;
+        wb->wait_tasks(5000);
+    }
+    return 0;
+}